@@ -8,20 +8,125 @@ CprE_DS3231::CprE_DS3231(int sda, int scl){
 }
 
 uint8_t CprE_DS3231::readAddr(byte reg) {
+	uint8_t v = 0;
+	readBlock(reg, &v, 1);
+	return v;
+}
+
+void CprE_DS3231::writeAddr(byte reg, byte val) {
+	writeBlock(reg, &val, 1);
+}
+
+// one pointer write and one burst read, shadow is updated on the way
+bool CprE_DS3231::readBlock(byte reg, uint8_t* buf, uint8_t len) {
 	Wire.beginTransmission(DS3231_ADDRESS);
 	Wire.write(reg);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDRESS, (byte)1);
-	return Wire.read();
+	if(Wire.endTransmission() != 0) 
+		return false;
+	if(Wire.requestFrom(DS3231_ADDRESS, len) != len) 
+		return false;
+	for(uint8_t i=0; i<len; i++) {
+		buf[i] = Wire.read();
+		uint8_t k = reg + i - DS3231_SHADOW;
+		if(reg + i >= DS3231_SHADOW && k < DS3231_NSHADOW && !(_dirty & (1 << k))) 
+			_reg[k] = buf[i];
+	}
+	return true;
 }
 
-void CprE_DS3231::writeAddr(byte reg, byte val) {
+void CprE_DS3231::writeBlock(byte reg, const uint8_t* buf, uint8_t len) {
 	Wire.beginTransmission(DS3231_ADDRESS);
 	Wire.write(reg);
-	Wire.write(val);
+	for(uint8_t i=0; i<len; i++) {
+		Wire.write(buf[i]);
+		uint8_t k = reg + i - DS3231_SHADOW;
+		if(reg + i >= DS3231_SHADOW && k < DS3231_NSHADOW) {
+			_reg[k] = buf[i];
+			_dirty &= ~(1 << k);
+		}
+	}
 	Wire.endTransmission();
 }
 
+uint8_t& CprE_DS3231::shadow(byte reg) {
+	if(!_loaded) 
+		load();
+	return _reg[reg - DS3231_SHADOW];
+}
+
+void CprE_DS3231::load() {
+	_dirty = 0;
+	_loaded = readBlock(DS3231_SHADOW, _reg, DS3231_NSHADOW);
+}
+
+void CprE_DS3231::hold() {
+	_held = true;
+}
+
+// nothing is changed while the shadow could not be read, a burst would
+// write unknown bytes around the register
+void CprE_DS3231::modify(byte reg, uint8_t mask, uint8_t val) {
+	uint8_t &r = shadow(reg);
+	if(!_loaded) 
+		return;
+	r = (r & ~mask) | (val & mask);
+	_dirty |= 1 << (reg - DS3231_SHADOW);
+	if(!_held) 
+		commit();
+}
+
+// write the span from first to last dirty register in one burst. Clean
+// registers inside the span are written so they do not change : alarm
+// flags and OSF as 1 (only a 0 clears them), CONV as 0.
+void CprE_DS3231::commit() {
+	_held = false;
+	if(_dirty == 0 || !_loaded) 
+		return;
+	uint8_t lo = 0, hi = DS3231_NSHADOW - 1;
+	while(!(_dirty & (1 << lo))) 
+		lo++;
+	while(!(_dirty & (1 << hi))) 
+		hi--;
+	uint8_t buf[DS3231_NSHADOW];
+	for(uint8_t k=lo; k<=hi; k++) {
+		uint8_t v = _reg[k];
+		bool dirty = _dirty & (1 << k);
+		if(k + DS3231_SHADOW == DS3231_STATUSREG) 
+			v |= dirty ? 0x80 : 0x83;
+		else if(k + DS3231_SHADOW == DS3231_CONTROL && !dirty) 
+			v &= ~0x20;
+		buf[k-lo] = v;
+	}
+	writeBlock(DS3231_SHADOW + lo, buf, hi - lo + 1);
+	_reg[DS3231_CONTROL - DS3231_SHADOW] &= ~0x20;		// CONV clears itself
+}
+
+uint8_t CprE_DS3231::status() {
+	uint8_t v = 0;
+	readBlock(DS3231_STATUSREG, &v, 1);
+	return v;
+}
+
+float CprE_DS3231::temperature() {
+	uint8_t t[2];
+	if(!readBlock(DS3231_TEMPERATUREREG, t, 2)) 
+		return NAN;
+	return (int8_t)t[0] + (t[1] >> 6) * 0.25f;
+}
+
+int8_t CprE_DS3231::agingOffset() {
+	return (int8_t)shadow(DS3231_AGING);
+}
+
+void CprE_DS3231::setAgingOffset(int8_t offset) {
+	bool held = _held;
+	_held = true;
+	modify(DS3231_AGING, 0xFF, (uint8_t)offset);
+	modify(DS3231_CONTROL, 0x20, 0x20);		// convert now so the new offset applies
+	if(!held) 
+		commit();
+}
+
 DateTime CprE_DS3231::now() {
   Wire.beginTransmission(DS3231_ADDRESS);
   Wire.write((byte)0);
@@ -59,14 +164,10 @@ String CprE_DS3231::currentTime() {
 
 String CprE_DS3231::getAlarm1() {
 	uint8_t s, m, h, D, mark;
-	Wire.beginTransmission(DS3231_ADDRESS);
-	Wire.write((byte)7);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDRESS, (byte)4);
-	s = Wire.read();
-	m = Wire.read();
-	h = Wire.read();
-	D = Wire.read();
+	s = shadow(DS3231_ALARM1);
+	m = shadow(DS3231_ALARM1+1);
+	h = shadow(DS3231_ALARM1+2);
+	D = shadow(DS3231_ALARM1+3);
 	mark = ((D&0x80)>>4)^((h&0x80)>>5)^((m&0x80)>>6)^((s&0x80)>>7);
 	String alm = "";
 	alm += (D&0x40)? "day ":"date ";
@@ -84,13 +185,9 @@ String CprE_DS3231::getAlarm1() {
 
 String CprE_DS3231::getAlarm2() {
 	uint8_t m, h, D, mark;
-	Wire.beginTransmission(DS3231_ADDRESS);
-	Wire.write((byte)0x0B);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDRESS, (byte)3);
-	m = Wire.read();
-	h = Wire.read();
-	D = Wire.read();
+	m = shadow(DS3231_ALARM2);
+	h = shadow(DS3231_ALARM2+1);
+	D = shadow(DS3231_ALARM2+2);
 	mark = ((D&0x80)>>5)^((h&0x80)>>6)^((m&0x80)>>7);
 	String alm = "";
 	alm += (D&0x40)? "day ":"data ";
@@ -113,16 +210,17 @@ void CprE_DS3231::setAlarm1(byte h, byte m, byte s, byte D, bool Dy, char mode)
 		case 'm': a1m1 = 0x00;	// Alarm when s match
 		case 's': break;		// Alarm every second
 	}
-	Wire.beginTransmission(DS3231_ADDRESS);
-	Wire.write((byte)7);
-	Wire.write(bin2bcd(s)|a1m1);
-	Wire.write(bin2bcd(m)|a1m2);
-	Wire.write(bin2bcd(h)|a1m3);
+	bool held = _held;
+	_held = true;
+	modify(DS3231_ALARM1, 0xFF, bin2bcd(s)|a1m1);
+	modify(DS3231_ALARM1+1, 0xFF, bin2bcd(m)|a1m2);
+	modify(DS3231_ALARM1+2, 0xFF, bin2bcd(h)|a1m3);
 	if(Dy) 
-		Wire.write(bin2bcd(D)|0x40|a1m4);
+		modify(DS3231_ALARM1+3, 0xFF, bin2bcd(D)|0x40|a1m4);
 	else 
-		Wire.write(bin2bcd(D)|a1m4);
-	Wire.endTransmission();
+		modify(DS3231_ALARM1+3, 0xFF, bin2bcd(D)|a1m4);
+	if(!held) 
+		commit();
 }
 
 void CprE_DS3231::setAlarm2(byte h, byte m, byte D, bool Dy, char mode) {
@@ -133,43 +231,30 @@ void CprE_DS3231::setAlarm2(byte h, byte m, byte D, bool Dy, char mode) {
 		case 'h': a2m2 = 0x00;	// Alarm when m match
 		case 'm': break;		// Alarm every minute
 	}
-	Wire.beginTransmission(DS3231_ADDRESS);
-	Wire.write((byte)0x0B);
-	Wire.write(bin2bcd(m)|a2m2);
-	Wire.write(bin2bcd(h)|a2m3);
+	bool held = _held;
+	_held = true;
+	modify(DS3231_ALARM2, 0xFF, bin2bcd(m)|a2m2);
+	modify(DS3231_ALARM2+1, 0xFF, bin2bcd(h)|a2m3);
 	if(Dy) 
-		Wire.write(bin2bcd(D)|0x40|a2m4);
+		modify(DS3231_ALARM2+2, 0xFF, bin2bcd(D)|0x40|a2m4);
 	else 
-		Wire.write(bin2bcd(D)|a2m4);
-	Wire.endTransmission();
+		modify(DS3231_ALARM2+2, 0xFF, bin2bcd(D)|a2m4);
+	if(!held) 
+		commit();
 }
 
 void CprE_DS3231::enableAlarm(uint8_t id) {
 	if(id > 2 || id < 1) 
 		return;
-	byte ctrl = readAddr(DS3231_CONTROL);
-	ctrl |= 0x04|id;
-	writeAddr(DS3231_CONTROL, ctrl);
+	modify(DS3231_CONTROL, 0x04|id, 0x04|id);
 }
 
 void CprE_DS3231::disableAlarm() {
-	byte ctrl = readAddr(DS3231_CONTROL);
-	ctrl &= ~0x03;
-	writeAddr(DS3231_CONTROL, ctrl);
+	modify(DS3231_CONTROL, 0x03, 0x00);
 }
 
 void CprE_DS3231::clearFlag() {
-	uint8_t sta;
-	Wire.beginTransmission(DS3231_ADDRESS);
-	Wire.write(DS3231_STATUSREG);
-	Wire.endTransmission();
-	Wire.requestFrom(DS3231_ADDRESS, (byte)1);
-	sta = Wire.read();
-	sta &= ~0x03;
-	Wire.beginTransmission(DS3231_ADDRESS);
-	Wire.write(DS3231_STATUSREG);
-	Wire.write(sta);
-	Wire.endTransmission();
+	modify(DS3231_STATUSREG, 0x03, 0x00);
 }
 
 bool CprE_DS3231::lostPower() {
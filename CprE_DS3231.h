@@ -5,6 +5,14 @@
 #include <Wire.h>
 #include "RTClib.h"
 
+#ifndef DS3231_ALARM1
+#define DS3231_ALARM1	0x07
+#define DS3231_ALARM2	0x0B
+#endif
+#define DS3231_AGING	0x10
+#define DS3231_SHADOW	DS3231_ALARM1	// first register kept in shadow
+#define DS3231_NSHADOW	12				// 0x07 - 0x12 : alarms, control, status, aging, temperature
+
 class CprE_DS3231 {
 	public:
 		CprE_DS3231(int sda, int scl);
@@ -12,6 +20,8 @@ class CprE_DS3231 {
 		uint8_t bin2bcd(uint8_t val) { return val+6 * (val/10); }
 		uint8_t readAddr(byte reg);
 		void writeAddr(byte reg, byte val);
+		bool readBlock(byte reg, uint8_t* buf, uint8_t len);
+		void writeBlock(byte reg, const uint8_t* buf, uint8_t len);
 		DateTime now();
 		String currentTime();
 		String getAlarm1();
@@ -25,8 +35,26 @@ class CprE_DS3231 {
 		bool lostPower();
 		void adjust(const DateTime& dt);
 		
+		// Shadow of 0x07-0x12 : changes are kept until commit(), which writes
+		// the dirty span in one burst. Between hold() and commit() several
+		// calls (setAlarm1, enableAlarm, clearFlag ...) share that burst.
+		void load();			// refresh shadow, one block read
+		void hold();
+		void commit();
+		uint8_t status();		// fresh status register (alarm flags, OSF)
+		float temperature();	// deg C, 0.25 resolution
+		int8_t agingOffset();
+		void setAgingOffset(int8_t offset);	// ~0.1 ppm per step, + slows the clock
+		
 	private:
 		RTC_DS3231 _rtclib;
+		uint8_t _reg[DS3231_NSHADOW];
+		uint16_t _dirty = 0;
+		bool _loaded = false;
+		bool _held = false;
+		
+		uint8_t& shadow(byte reg);
+		void modify(byte reg, uint8_t mask, uint8_t val);
 };
 
 #endif
@@ -11,156 +11,194 @@ Re-coding to compatible with IoTtweet.com
 #include "CprE_NB_bc95.h"
 
 bool CprE_NB_bc95::reboot() {
+  process();
   MODEM_SERIAL -> println(F("AT+NRB"));
+  return waitFor("REBOOTING", 2000) == AT_FOUND;
 }
 
 void CprE_NB_bc95::init(Stream &serial) {
   MODEM_SERIAL = &serial;
+  _lineLen = 0;
+  _lineReady = false;
 }
 
-String CprE_NB_bc95::getIMEI()
-{
-  MODEM_SERIAL->println(F("AT+CGSN=1")); // Request Product Serial Number
-  char waitForCGSN[] = "+CGSN:";
-  String re_str;
-  re_str = expect_rx_str(1000, waitForCGSN, 6);
+bool CprE_NB_bc95::onURC(const char* prefix, urcHandler handler, void* arg) {
+  if (_urcCount >= MODEM_URC_MAX)
+    return false;
+  _urc[_urcCount].prefix = prefix;
+  _urc[_urcCount].handler = handler;
+  _urc[_urcCount].arg = arg;
+  _urcCount++;
+  return true;
+}
 
-  if (re_str != "") {
-    return re_str;
+/* collect available bytes into _line, true when a complete non-empty line is
+   there. Over-long lines are truncated, never overflow. */
+bool CprE_NB_bc95::readLine() {
+  if (_lineReady) {
+    _lineReady = false;
+    _lineLen = 0;
   }
-  return "";
+  while (MODEM_SERIAL->available()) {
+    char c = MODEM_SERIAL->read();
+    if (c == '\n') {
+      if (_lineLen == 0)
+        continue;
+      _line[_lineLen] = '\0';
+      _lineReady = true;
+      return true;
+    }
+    if (c == '\r')
+      continue;
+    if (_lineLen < MODEM_RESP - 1)
+      _line[_lineLen++] = c;
+  }
+  return false;
 }
 
-String CprE_NB_bc95::getIMSI()
-{
-  MODEM_SERIAL->println(F("AT+CIMI")); // Request International Mobile Subscriber Identity
-  char waitForMISI[] = "\r\n";
-  String re_str;
-  re_str = expect_rx_str(1000, waitForMISI, 2);
-
-  if (re_str != "") {
-    return re_str;
+bool CprE_NB_bc95::dispatch() {
+  for (uint8_t i = 0; i < _urcCount; i++) {
+    if (strncmp(_line, _urc[i].prefix, strlen(_urc[i].prefix)) == 0) {
+      _urc[i].handler(_line, _urc[i].arg);
+      return true;
+    }
   }
-  return "";
+  return false;
 }
 
-String CprE_NB_bc95::expect_rx_str( unsigned long period, char exp_str[], int len_check) {
-  unsigned long cur_t = millis();
+void CprE_NB_bc95::process() {
+  while (readLine())
+    dispatch();   // anything else is a leftover of an earlier command
+}
+
+/* wait for a line starting with prefix (copied to out), OK or ERROR.
+   prefix "" takes the first bare information line (not +XXX:), NULL waits
+   for OK/ERROR only.
+   Command echo is skipped, URCs are dispatched on the way. */
+int CprE_NB_bc95::waitFor(const char* prefix, unsigned long timeout, char* out, int outlen) {
   unsigned long start_t = millis();
-  bool str_found = 0;
-  bool time_out = 0;
-  bool loop_out = 0;
-  int i = 0;
-  int found_index = 0, end_index = 0;
-  int modem_said_len = 0;
-  char c;
-  char modem_said[MODEM_RESP];
-  String re_str;
-  char str[BUF_MAX_SIZE];
-  char *x;
-
-  while ( !loop_out ) {
-    if (MODEM_SERIAL->available()) {
-      c = MODEM_SERIAL->read();
-      modem_said[i++] = c;
+  while (millis() - start_t < timeout) {
+    if (!readLine()) {
+      delay(1);
+      continue;
     }
-    else {
+    if (strncmp(_line, "AT", 2) == 0)
+      continue;
+    bool found = prefix && strncmp(_line, prefix, strlen(prefix)) == 0;
+    if (found && prefix[0] == '\0' && _line[0] == '+')
+      found = false;
+    if (!found || prefix[0] == '\0') {
+      if (dispatch())
+        continue;
+      if (strcmp(_line, "OK") == 0)
+        return AT_OK;
+      if (strcmp(_line, "ERROR") == 0 || strncmp(_line, "+CME ERROR", 10) == 0)
+        return AT_ERROR;
     }
-    cur_t = millis();
-    if ( cur_t - start_t > period ) {
-      time_out = true;
-      start_t = cur_t;
-      loop_out = true;
+    if (found) {
+      if (out && outlen > 0) {
+        strncpy(out, _line, outlen - 1);
+        out[outlen - 1] = '\0';
+      }
+      return AT_FOUND;
     }
-  }//while
-  modem_said[i] = '\0';
-  end_index = i;
-  x = strstr(modem_said, exp_str) ;
-  found_index = x ? x - modem_said : -1;
-  if ( found_index >= 0  ) {
-    i = 0;
-    while ( modem_said[found_index + i + len_check] != 0x0D | i == 0) {
-      str[i] = modem_said[found_index + i + len_check];
-      re_str += String(str[i]);
-      i++;
-    }
-    str[i] = '\0';
-    return re_str;
+  }
+  return AT_TIMEOUT;
+}
+
+/* send cmd and wait for its response, an expected line is followed by the
+   final OK which is consumed too so it does not answer the next command */
+int CprE_NB_bc95::command(const char* cmd, const char* prefix, unsigned long timeout, char* out, int outlen) {
+  process();
+  MODEM_SERIAL->println(cmd);
+  int r = waitFor(prefix, timeout, out, outlen);
+  if (r == AT_FOUND)
+    waitFor(NULL, timeout);
+  return r;
+}
+
+String CprE_NB_bc95::getIMEI()
+{
+  char resp[MODEM_RESP];
+  // Request Product Serial Number
+  if (command("AT+CGSN=1", "+CGSN:", 1000, resp, sizeof(resp)) == AT_FOUND) {
+    return String(resp + 6);
   }
   return "";
 }
 
+String CprE_NB_bc95::getIMSI()
+{
+  char resp[MODEM_RESP];
+  // Request International Mobile Subscriber Identity, answered as a bare line
+  if (command("AT+CIMI", "", 1000, resp, sizeof(resp)) == AT_FOUND) {
+    return String(resp);
+  }
+  return "";
+}
+
+/* kept for sketches : returns text after exp_str (skipping len_check chars)
+   on the matching line, or the line itself when nothing follows.
+   "\r\n" means the first information line. Returns as soon as it is seen. */
+String CprE_NB_bc95::expect_rx_str( unsigned long period, char exp_str[], int len_check) {
+  char resp[MODEM_RESP];
+  const char* prefix = strcmp(exp_str, "\r\n") == 0 ? "" : exp_str;
+  if (waitFor(prefix, period, resp, sizeof(resp)) != AT_FOUND)
+    return "";
+  if (prefix[0] == '\0' || len_check >= (int)strlen(resp))
+    return String(resp);
+  return String(resp + len_check);
+}
+
 bool CprE_NB_bc95::initModem() {
   // Serial.println(F("######### CprE_NB_bc95 Library based on True_NB_BC95 ##########"));
   // Serial.println( "initial Modem to connect NB-IoT Network" );
-  MODEM_SERIAL->println(F("AT+NRB"));
-  delay(5000);
-  char waitForReboot[] = "REBOOTING";
-  if ( expect_rx_str(2000, waitForReboot, 9) != "" ) {
-    // Serial.println("Reboot done Connecting to Network");
+  if (reboot()) {
+    // reboot banner ends with OK once the modem is ready
+    waitFor(NULL, 10000);
   }
-  MODEM_SERIAL->println(F("AT+CFUN=1"));
-  delay(2000);
-  MODEM_SERIAL->println(F("AT"));
-  delay(1000);
+  if (command("AT+CFUN=1", NULL, 10000) != AT_OK)
+    return false;
+  return command("AT", NULL, 1000) == AT_OK;
 }
 
 bool CprE_NB_bc95::register_network() {
-  bool regist = 0;
-  delay(2000);
-  MODEM_SERIAL->println(F("AT+CGATT=1")); // Activate the network.
-  delay(3000);
+  command("AT+CGATT=1", NULL, 1000); // Activate the network.
   /* Query whether network is activated, +CGATT:1 means activated successfully,
      sometimes customers need to wait for 30s.
   */
-  MODEM_SERIAL->println(F("AT+CGATT?")); // Query whether network is activated
-  delay(1000);
-  char waitForCGATT[] = "+CGATT:1"; // +CGATT:1 means activated successfully
-  if (expect_rx_str(1000, waitForCGATT, 8 ) != "" ) {
-    Serial.println("register network Done!");
-    return true;
-  }
-  else {
-    Serial.println("register network Fail!");
-    return false;
-  }
+  unsigned long start_t = millis();
+  do {
+    if (attached()) {
+      Serial.println("register network Done!");
+      return true;
+    }
+    delay(500);
+  } while (millis() - start_t < MODEM_ATTACH_WAIT);
+  Serial.println("register network Fail!");
+  return false;
+}
+
+bool CprE_NB_bc95::attached() {
+  char resp[MODEM_RESP];
+  // +CGATT:1 means attached to the network
+  return command("AT+CGATT?", "+CGATT:", 1000, resp, sizeof(resp)) == AT_FOUND && resp[7] == '1';
 }
 
 String CprE_NB_bc95::check_ipaddr() {
-  MODEM_SERIAL->println(F("AT+CGPADDR=0")); // Show PDP Addresses
-  delay(1000);
-  char waitForCGPADDR[] = "+CGPADDR:0,";
-  String re_str;
-  re_str = expect_rx_str(1000, waitForCGPADDR, 11 );
-  if ( re_str != "" ) {
-    return re_str;
+  char resp[MODEM_RESP];
+  // Show PDP Addresses
+  if (command("AT+CGPADDR=0", "+CGPADDR:0,", 1000, resp, sizeof(resp)) == AT_FOUND) {
+    return String(resp + 11);
   }
   return "";
 }
 
 int CprE_NB_bc95::check_modem_signal() {
-  char resp_result[BUF_MAX_SIZE];
-  int index = 0;
+  char resp[MODEM_RESP];
   int ssi;
-  char ssi_str[3];
-  MODEM_SERIAL->println("AT+CSQ");
-  char waitForCSQ[] = "+CSQ:";
-  String re_str;
-  re_str = expect_rx_str( 1000, waitForCSQ, 5);
-  if ( re_str != "" ) {
-    ssi_str[0] = re_str[0];
-    // check the next char is not "," It is not single digit
-    if ( re_str[1] != 0x2c) {
-      //Serial.println( resp_result[index+2]);
-      ssi_str[1] = re_str[1];
-      ssi_str[2] = '\0';
-      ssi = atoi(ssi_str);
-      ssi = -1 * (113 - ssi * 2);
-      return ssi;
-    }
-    // it is single digit
-    ssi_str[1] = '\0';
-    ssi = atoi(ssi_str);
+  if (command("AT+CSQ", "+CSQ:", 1000, resp, sizeof(resp)) == AT_FOUND) {
+    ssi = atoi(resp + 5);   // +CSQ:<rssi>,<ber>
     ssi = -1 * (113 - ssi * 2);
     return ssi;
   }
@@ -170,60 +208,135 @@ int CprE_NB_bc95::check_modem_signal() {
 
 }
 
-bool CprE_NB_bc95::create_UDP_socket(int port, char sock_num[]) {
+// days since 1970-01-01 (H. Hinnant's days_from_civil)
+static uint32_t civilDays(int y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  unsigned era = y / 400;
+  unsigned yoe = y - era * 400;
+  unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
 
-  MODEM_SERIAL->print(F("AT+NSOCR=DGRAM,17,")); // supported value is DGRAM, UDP is 17
-  MODEM_SERIAL->print( port );
-  MODEM_SERIAL->println(F(",1")); // Set to 1 if incoming messages should be received
-  delay(2000);
-  if ( expect_rx_str(1000, sock_num, 1) != "" ) {
-    return true;
+uint32_t CprE_NB_bc95::networkTime() {
+  char resp[MODEM_RESP];
+  int y, M, d, h, m, s;
+  // +CCLK:yy/MM/dd,hh:mm:ss+zz, network (NITZ) time in UTC, zz is the local
+  // zone in quarter hours and is not applied
+  if (command("AT+CCLK?", "+CCLK:", 1000, resp, sizeof(resp)) != AT_FOUND) {
+    return 0;
   }
-  return false;
+  const char* p = resp + 6;
+  if (*p == '"') {
+    p++;
+  }
+  if (sscanf(p, "%d/%d/%d,%d:%d:%d", &y, &M, &d, &h, &m, &s) != 6 || y < 20 || M < 1 || M > 12) {
+    return 0;
+  }
+  return civilDays(2000 + y, M, d) * 86400UL + h * 3600UL + m * 60UL + s;
+}
+
+bool CprE_NB_bc95::create_UDP_socket(int port, char sock_num[]) {
+  char cmd[40];
+  // supported value is DGRAM, UDP is 17, set to 1 if incoming messages should be received
+  snprintf(cmd, sizeof(cmd), "AT+NSOCR=DGRAM,17,%d,1", port);
+  // modem answers the socket number
+  return command(cmd, sock_num, 3000) == AT_FOUND;
 }
 
 bool CprE_NB_bc95::sendUDPstr(String ip, String port, String data) {
+  return sendUDP(ip.c_str(), port.c_str(), (const uint8_t*)data.c_str(), data.length());
+}
 
-  int str_len = data.length();
-  char buffer[str_len+2];
-  data.toCharArray(buffer, str_len+1);
-
-  /* Start AT command */
-  MODEM_SERIAL->print(F("AT+NSOST=0"));
-  MODEM_SERIAL->print(F(","));
-  MODEM_SERIAL->print(ip);
-  MODEM_SERIAL->print(F(","));
-  MODEM_SERIAL->print(port);
-  MODEM_SERIAL->print(F(","));
-  MODEM_SERIAL->print(String(str_len));
-  MODEM_SERIAL->print(F(","));
-  /*
-  Serial.print("AT+NSOST=0");
-  Serial.print(",");
-  Serial.print(ip);
-  Serial.print(",");
-  Serial.print(port);
-  Serial.print(",");
-  Serial.print(String(str_len));
-  Serial.println(",");
-  /*
-
-  /* Fetch print data in hex format */
-  char *h_buf;
-  h_buf = buffer;
-  char fetch[3] = "";
-  bool chk = false;
-  int i=0;
-
-  while(*h_buf)
-  {
-    chk = itoa((int)*h_buf,fetch,16);
-    if(chk){
-      MODEM_SERIAL->print(fetch);
+/* binary safe send on socket 0 : payload is hex encoded into _tx and the
+   command goes out in MODEM_TX_SIZE chunks. True when the modem confirms
+   <socket>,<len> for the whole payload. With flags, AT+NSOSTF is used to
+   ask the network for an early radio release. */
+bool CprE_NB_bc95::sendUDP(const char* ip, const char* port, const uint8_t* data, size_t len, uint16_t flags) {
+  static const char hex[] = "0123456789ABCDEF";
+  if (len == 0 || len > MODEM_UDP_MAX)
+    return false;
+
+  process();
+  int n;
+  if (flags)
+    n = snprintf(_tx, sizeof(_tx), "AT+NSOSTF=0,%s,%s,0x%X,%u,", ip, port, flags, (unsigned)len);
+  else
+    n = snprintf(_tx, sizeof(_tx), "AT+NSOST=0,%s,%s,%u,", ip, port, (unsigned)len);
+  if (n <= 0 || n >= MODEM_TX_SIZE - 2)
+    return false;
+  for (size_t i = 0; i < len; i++) {
+    if (n > MODEM_TX_SIZE - 2) {
+      MODEM_SERIAL->write((const uint8_t*)_tx, n);
+      n = 0;
     }
-    h_buf++;
+    _tx[n++] = hex[data[i] >> 4];
+    _tx[n++] = hex[data[i] & 0x0F];
+  }
+  if (n > MODEM_TX_SIZE - 2) {
+    MODEM_SERIAL->write((const uint8_t*)_tx, n);
+    n = 0;
   }
-  MODEM_SERIAL->print("\r\n");
+  _tx[n++] = '\r';
+  _tx[n++] = '\n';
+  MODEM_SERIAL->write((const uint8_t*)_tx, n);
+
+  // modem answers <socket>,<bytes sent> then OK
+  char resp[MODEM_RESP];
+  if (waitFor("", 1000, resp, sizeof(resp)) != AT_FOUND)
+    return false;
+  waitFor(NULL, 1000);
+  char* comma = strchr(resp, ',');
+  return comma && (size_t)atoi(comma + 1) == len;
+}
+
+static int hexval(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/* read a datagram waiting on socket 0 (announced by +NSONMI), in chunks that
+   fit one response line. Returns bytes read, 0 when nothing, -1 on error */
+int CprE_NB_bc95::receiveUDP(uint8_t* buf, size_t size) {
+  char cmd[24];
+  char resp[MODEM_RESP];
+  size_t n = 0;
+  int remaining = 0;
+  do {
+    size_t want = min(size - n, (size_t)(MODEM_RESP - 48) / 2);
+    if (want == 0)
+      break;
+    snprintf(cmd, sizeof(cmd), "AT+NSORF=0,%u", (unsigned)want);
+    int r = command(cmd, "", 1000, resp, sizeof(resp));
+    if (r == AT_OK)
+      break;      // nothing left to read
+    if (r != AT_FOUND)
+      return -1;
+    // <socket>,<ip>,<port>,<length>,<data>,<remaining>
+    char* p = resp;
+    for (uint8_t i = 0; i < 3 && p; i++) {
+      p = strchr(p, ',');
+      if (p) p++;
+    }
+    if (!p)
+      return -1;
+    int len = atoi(p);
+    p = strchr(p, ',');
+    if (!p)
+      return -1;
+    p++;
+    for (int i = 0; i < len && n < size; i++, p += 2) {
+      int hi = hexval(p[0]), lo = hi < 0 ? -1 : hexval(p[1]);
+      if (lo < 0)
+        return -1;
+      buf[n++] = (hi << 4) | lo;
+    }
+    p = strchr(p, ',');
+    remaining = p ? atoi(p + 1) : 0;
+  } while (remaining > 0);
+  return n;
 }
 
 String CprE_NB_bc95::WriteDashboardIoTtweet(String userid, String key, float slot0, float slot1, float slot2, float slot3, String tw, String twpb){
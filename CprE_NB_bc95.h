@@ -22,7 +22,24 @@
 #define COAP_PUT  3
 #define COAP_DELETE  4
 
-#define MODEM_RESP 128
+#define MODEM_RESP 256
+#define MODEM_TX_SIZE 256         // AT+NSOST is written in chunks of this size
+#define MODEM_UDP_MAX 512         // max datagram payload accepted by AT+NSOST
+#define MODEM_URC_MAX 4           // number of URC handlers that can be registered
+#define MODEM_ATTACH_WAIT 10000   // ms to poll +CGATT for attach in register_network()
+
+/* AT+NSOSTF release assistance flags for sendUDP() */
+#define MODEM_RAI_NONE 0x000
+#define MODEM_RAI_LAST 0x200      // release RRC right after this uplink
+#define MODEM_RAI_REPLY 0x400     // release after the first downlink (e.g. CoAP ACK)
+
+/* waitFor()/command() results */
+#define AT_ERROR -1       // ERROR or +CME ERROR
+#define AT_TIMEOUT 0      // nothing conclusive before timeout
+#define AT_FOUND 1        // line with expected prefix seen
+#define AT_OK 2           // final OK seen
+
+typedef void (*urcHandler)(const char* line, void* arg);
 
 /* Dashboard Partner parameter : IoTtweet.com */
 #define IoTtweetNBIoT_HOST "35.185.177.33"    // - New Cloud IoTtweet server IP
@@ -37,14 +54,39 @@ class CprE_NB_bc95 {
     String expect_rx_str( unsigned long period, char exp_str[], int len_check);
     bool initModem();
     bool register_network();
+    bool attached();
     String check_ipaddr();
     int check_modem_signal();
+    uint32_t networkTime();   // AT+CCLK? as unix time (UTC), 0 when the modem has no time yet
     bool create_UDP_socket(int port, char sock_num[]);
     bool sendUDPstr(String ip, String port, String data);
+    bool sendUDP(const char* ip, const char* port, const uint8_t* data, size_t len, uint16_t flags = MODEM_RAI_NONE);
+    int receiveUDP(uint8_t* buf, size_t size);
     String WriteDashboardIoTtweet(String userid, String key, float slot0, float slot1, float slot2, float slot3, String tw, String twpb);
 
+    /* AT engine : lines are read incrementally into a bounded buffer,
+       waits end on OK/ERROR/expected prefix, unsolicited lines (URC)
+       go to handlers registered with onURC() */
+    bool onURC(const char* prefix, urcHandler handler, void* arg = NULL);
+    void process();   // pump modem output and dispatch URCs, call from loop()
+    int waitFor(const char* prefix, unsigned long timeout, char* out = NULL, int outlen = 0);
+    int command(const char* cmd, const char* prefix, unsigned long timeout, char* out = NULL, int outlen = 0);
+
   private:
     Stream* MODEM_SERIAL;
+    char _tx[MODEM_TX_SIZE];  // AT+NSOST command buffer
+    char _line[MODEM_RESP];   // line being assembled
+    int _lineLen = 0;
+    bool _lineReady = false;
+    struct {
+      const char* prefix;
+      urcHandler handler;
+      void* arg;
+    } _urc[MODEM_URC_MAX];
+    uint8_t _urcCount = 0;
+
+    bool readLine();
+    bool dispatch();
     String _packet, _userid, _key, _tw, _twpb;
     float _slot0, _slot1, _slot2, _slot3;
 
@@ -0,0 +1,238 @@
+#include "CprE_backfill.h"
+
+#define BF_CURSOR_SIZE	(8 + LS_NAME_LEN + 2)	// magic, offset, segment name, CRC
+
+static void put32(uint8_t* p, uint32_t v) {
+	for(uint8_t i=0; i<4; i++) 
+		p[i] = v >> (8 * i);
+}
+
+static uint32_t get32(const uint8_t* p) {
+	return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool CprE_backfill::begin(fs::FS &fs, CprE_logStore &store, const char* path) {
+	_fs = &fs;
+	_store = &store;
+	strncpy(_path, path, LS_PATH_LEN - 1);
+	_path[LS_PATH_LEN - 1] = '\0';
+	_file.close();
+	_records = 0;
+	_skipped = 0;
+	_peekCount = 0;
+	_peekSkipped = 0;
+	File f = fs.open(_path, FILE_READ);
+	uint8_t c[BF_CURSOR_SIZE];
+	if(f && f.read(c, BF_CURSOR_SIZE) == BF_CURSOR_SIZE) {
+		uint16_t crc = CprE_crc16::compute(c, BF_CURSOR_SIZE - 2);
+		if(get32(c) == BF_MAGIC && crc == (c[BF_CURSOR_SIZE - 2] | c[BF_CURSOR_SIZE - 1] << 8)) {
+			_pos = get32(c + 4);
+			memcpy(_name, c + 8, LS_NAME_LEN);
+			_name[LS_NAME_LEN - 1] = '\0';
+			return true;
+		}
+	}
+	// no cursor yet : everything on the card is pending
+	_pos = 0;
+	if(!CprE_logStore::firstSegment(fs, store.directory(), _name)) 
+		return false;
+	save();
+	return true;
+}
+
+void CprE_backfill::save() {
+	uint8_t c[BF_CURSOR_SIZE] = {0};
+	put32(c, BF_MAGIC);
+	put32(c + 4, _pos);
+	strncpy((char*)c + 8, _name, LS_NAME_LEN - 1);
+	uint16_t crc = CprE_crc16::compute(c, BF_CURSOR_SIZE - 2);
+	c[BF_CURSOR_SIZE - 2] = crc;
+	c[BF_CURSOR_SIZE - 1] = crc >> 8;
+	_dirty = false;
+	File f = _fs->open(_path, FILE_WRITE);
+	if(f) {
+		f.write(c, BF_CURSOR_SIZE);
+		f.close();
+	}
+}
+
+// the segment the store is writing to
+bool CprE_backfill::active() {
+	return strcmp(_name, _store->segment() + strlen(_store->directory()) + 1) == 0;
+}
+
+// an active segment may still grow : its file is reopened once the records
+// run out, so the size is fresh. A closed segment is read in one go
+bool CprE_backfill::openSegment() {
+	char p[LS_PATH_LEN];
+	_live = active();
+	snprintf(p, sizeof(p), "%s/%s", _store->directory(), _name);
+	_file = _fs->open(p, FILE_READ);
+	if(_file) 
+		return true;
+	// deleted by retention, go on with the next one
+	return !_live && nextSegment();
+}
+
+bool CprE_backfill::nextSegment() {
+	_file.close();
+	char name[LS_NAME_LEN];
+	if(!CprE_logStore::firstSegment(*_fs, _store->directory(), name, _name)) 
+		return false;
+	strcpy(_name, name);
+	_pos = 0;
+	_peekPos = 0;
+	_dirty = true;
+	return openSegment();
+}
+
+size_t CprE_backfill::peek(uint8_t* buf, size_t size) {
+	size_t n = 0;
+	_peekPos = _pos;
+	_peekCount = 0;
+	_peekSkipped = 0;
+	if(!_file && !openSegment()) 
+		return 0;
+	while(n + LS_RECORD_HEAD < size) {
+		uint8_t h[LS_RECORD_HEAD];
+		uint32_t pos = _peekPos;
+		int32_t len = -1;
+		if(_file.seek(pos) && _file.read(h, LS_RECORD_HEAD) == LS_RECORD_HEAD) {
+			uint16_t l = h[0] | h[1] << 8;
+			if(n + LS_RECORD_HEAD + l <= size) 
+				len = CprE_logStore::read(_file, _peekPos, buf + n + LS_RECORD_HEAD, l);
+			else if(LS_RECORD_HEAD + l <= size) 
+				break;		// next datagram
+			else if(CprE_logStore::scan(_file, pos, 1) > pos) {
+				// valid but larger than any datagram
+				_peekPos += LS_RECORD_HEAD + l + 2;
+				_peekSkipped++;
+				continue;
+			}
+		}
+		if(len >= 0) {
+			buf[n] = len;
+			buf[n + 1] = len >> 8;
+			n += LS_RECORD_HEAD + len;
+			_peekCount++;
+			continue;
+		}
+		// end of the records
+		if(n > 0) 
+			break;
+		if(_live) {
+			_file.close();
+			if(active() || !openSegment()) 
+				break;		// wait for more, or read the rest now it is closed
+		}
+		else if(!nextSegment()) 
+			break;
+	}
+	if(n == 0) 
+		advance();		// only oversized records, nothing to send
+	return n;
+}
+
+void CprE_backfill::advance() {
+	if(_peekPos == _pos) 
+		return;
+	_pos = _peekPos;
+	_records += _peekCount;
+	_skipped += _peekSkipped;
+	_peekCount = 0;
+	_peekSkipped = 0;
+	_dirty = true;
+}
+
+void CprE_backfill::ack() {
+	advance();
+	save();
+}
+
+// one AT+NSOST per call : each send blocks loop() for the modem reply
+int CprE_backfill::service(CprE_NB_bc95 &modem, const char* ip, const char* port) {
+	if(millis() - _last < _interval || !pending()) 
+		return 0;
+	_last = millis();
+	if(!_linkUp) {
+		_linkUp = modem.attached();
+		if(!_linkUp) 
+			return 0;
+	}
+	uint8_t dgram[MODEM_UDP_MAX];
+	int sent = 0;
+	size_t n = peek(dgram, sizeof(dgram));
+	if(n > 0) {
+		if(modem.sendUDP(ip, port, dgram, n)) {
+			advance();
+			sent = 1;
+		}
+		else 
+			_linkUp = false;		// check attach again before next send
+	}
+	if(_dirty) 
+		save();
+	return sent;
+}
+
+int CprE_backfill::service(UDP &udp, const char* host, uint16_t port) {
+	if(millis() - _last < _interval || !pending()) 
+		return 0;
+	_last = millis();
+	uint8_t dgram[BF_UDP_MAX];
+	int sent = 0;
+	while(sent < _burst) {
+		size_t n = peek(dgram, sizeof(dgram));
+		if(n == 0) 
+			break;
+		if(!udp.beginPacket(host, port) || udp.write(dgram, n) != n || !udp.endPacket()) 
+			break;
+		advance();
+		sent++;
+	}
+	if(_dirty) 
+		save();
+	return sent;
+}
+
+void CprE_backfill::setRate(unsigned long interval, uint8_t burst) {
+	_interval = interval;
+	_burst = burst;
+}
+
+// closed segments read to their end are left here, so once the store
+// opened a new one (boot, rotation) the cursor reaches it without a send
+bool CprE_backfill::pending() {
+	while(!active()) {
+		if(!_file && !openSegment()) 
+			return true;
+		if(active() || CprE_logStore::scan(_file, _pos, 1) > _pos || !nextSegment()) 
+			break;
+	}
+	return !active() || _pos < _store->offset();
+}
+
+void CprE_backfill::skip() {
+	_file.close();
+	strcpy(_name, _store->segment() + strlen(_store->directory()) + 1);
+	_pos = _store->offset();
+	_peekCount = 0;
+	_peekSkipped = 0;
+	save();
+}
+
+const char* CprE_backfill::segment() {
+	return _name;
+}
+
+uint32_t CprE_backfill::offset() {
+	return _pos;
+}
+
+uint32_t CprE_backfill::records() {
+	return _records;
+}
+
+uint32_t CprE_backfill::skipped() {
+	return _skipped;
+}
@@ -0,0 +1,80 @@
+#ifndef CPRE_BACKFILL_H
+#define CPRE_BACKFILL_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <Udp.h>
+#include "CprE_crc16.h"
+#include "CprE_logStore.h"
+#include "CprE_NB_bc95.h"
+
+#define BF_MAGIC		0x31434642	// "BFC1"
+#define BF_INTERVAL		1000		// ms between send bursts
+#define BF_BURST		4			// datagrams per burst (WiFi)
+#define BF_UDP_MAX		1400		// WiFi datagram, below the Ethernet MTU
+
+// Backfill of a CprE_logStore : a cursor (segment name and offset) marks
+// the first record the server has not got. It is kept in a small file so
+// it survives reset. Once the link is back, service() packs the records
+// after it into datagrams, [len lo][len hi][record][len lo][len hi]...,
+// and moves the cursor once the modem or the UDP stack took the datagram.
+// UDP has no acknowledgement : a datagram lost on the way or while the
+// server is down is not sent again, so service() covers link outages only
+// and delivers at most once per cursor move (a reset before the cursor
+// save sends a batch again). For delivery confirmed by the server, send
+// what peek() returns yourself and call ack() on the server's reply.
+// The burst/interval rate keeps the uplink free for live traffic : a day
+// of Project8 records (288 x ~420 bytes) is sent in about a minute.
+// Live sends go around the backfill, skip() marks them delivered when the
+// cursor was already at the end of the store, with the same UDP caveat.
+class CprE_backfill {
+	public:
+		// with no cursor file the backfill starts at the oldest segment
+		bool begin(fs::FS &fs, CprE_logStore &store, const char* path);
+
+		// pack records from the cursor into buf, ack() moves past them
+		size_t peek(uint8_t* buf, size_t size);
+		void ack();
+
+		// call from loop(), returns datagrams sent. BC95 : one datagram
+		// every interval. WiFi : at most burst datagrams every interval,
+		// only call while connected
+		int service(CprE_NB_bc95 &modem, const char* ip, const char* port);
+		int service(UDP &udp, const char* host, uint16_t port);
+		void setRate(unsigned long interval, uint8_t burst);
+
+		bool pending();			// cursor behind the end of the store
+		void skip();			// all stored records count as delivered
+
+		const char* segment();	// cursor segment name
+		uint32_t offset();
+		uint32_t records();		// records sent since begin()
+		uint32_t skipped();		// records too large for a datagram
+
+	private:
+		fs::FS* _fs;
+		CprE_logStore* _store;
+		char _path[LS_PATH_LEN];
+		char _name[LS_NAME_LEN];
+		uint32_t _pos = 0;
+		File _file;				// open cursor segment
+		bool _live = false;		// it was the active one when opened
+		bool _dirty = false;	// cursor moved since the last save
+		uint32_t _peekPos = 0;
+		uint16_t _peekCount = 0;
+		uint16_t _peekSkipped = 0;
+		uint32_t _records = 0;
+		uint32_t _skipped = 0;
+		unsigned long _interval = BF_INTERVAL;
+		unsigned long _last = 0;
+		uint8_t _burst = BF_BURST;
+		bool _linkUp = false;
+
+		bool active();
+		bool openSegment();
+		bool nextSegment();
+		void advance();
+		void save();
+};
+
+#endif
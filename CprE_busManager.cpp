@@ -0,0 +1,66 @@
+#include "CprE_busManager.h"
+
+int CprE_busManager::addBus(HardwareSerial &serial, int dirpin, mbPoint* points, int n, unsigned long period, int core, uint8_t max_gap) {
+	if(_nbus >= MB_MAX_BUS) 
+		return -1;
+	mbBus &b = _bus[_nbus];
+	b.rtu.initSerial(serial, dirpin);
+	b.points = points;
+	b.n = n;
+	b.period = period;
+	b.core = core;
+	b.gap = max_gap;
+	b.id = _nbus;
+	b.task = NULL;
+	b.dropped = 0;
+	b.cycles = 0;
+	return _nbus++;
+}
+
+bool CprE_busManager::start(UBaseType_t priority) {
+	char name[] = "mbBus0";
+	for(uint8_t i=0; i<_nbus; i++) {
+		if(_bus[i].task != NULL) 
+			continue;						// already running
+		name[5] = '0'+i;
+		if(xTaskCreatePinnedToCore(worker, name, MB_BUS_STACK, &_bus[i], priority, &_bus[i].task, _bus[i].core) != pdPASS) 
+			return false;
+	}
+	return true;
+}
+
+void CprE_busManager::worker(void* arg) {
+	mbBus &b = *(mbBus*)arg;
+	TickType_t last = xTaskGetTickCount();
+	while(true) {
+		b.rtu.readPlan(b.points, b.n, b.gap);
+		unsigned long t = millis();
+		for(int i=0; i<b.n; i++) {
+			mbResult res = {b.id, (uint16_t)i, b.points[i].error, b.points[i].value, t};
+			if(!b.results.push(res)) 
+				b.dropped++;
+		}
+		b.cycles++;
+		vTaskDelayUntil(&last, pdMS_TO_TICKS(b.period));
+	}
+}
+
+bool CprE_busManager::getResult(mbResult &res) {
+	// round robin so a busy bus can't starve the others
+	for(uint8_t k=0; k<_nbus; k++) {
+		uint8_t i = (_next+k) % _nbus;
+		if(_bus[i].results.pop(res)) {
+			_next = (i+1) % _nbus;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t CprE_busManager::dropped(int bus) {
+	return (bus >= 0 && bus < _nbus)? _bus[bus].dropped : 0;
+}
+
+uint32_t CprE_busManager::cycles(int bus) {
+	return (bus >= 0 && bus < _nbus)? _bus[bus].cycles : 0;
+}
@@ -0,0 +1,56 @@
+#ifndef CPRE_BUS_MANAGER_H
+#define CPRE_BUS_MANAGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "CprE_modbusRTU.h"
+#include "CprE_spscQueue.h"
+
+#define MB_MAX_BUS		3		// ESP32 has 3 UARTs
+#define MB_BUS_RESULTS	64		// result queue length of each bus
+#define MB_BUS_STACK	4096	// stack size of each worker task
+
+// value read by a bus worker
+struct mbResult {
+	uint8_t  bus;		// bus id returned by addBus()
+	uint16_t index;		// index of point in poll list of that bus
+	uint8_t  error;
+	float    value;
+	unsigned long time;	// millis() when point was read
+};
+
+// Run one worker task per RS485 port. Each task polls its own point list with
+// readPlan() every <period> ms and publishes results through a lock-free queue.
+// Points given to addBus() belong to the worker task after start().
+class CprE_busManager {
+	public:
+		int addBus(HardwareSerial &serial, int dirpin, mbPoint* points, int n, unsigned long period, 
+				   int core = 1, uint8_t max_gap = MB_PLAN_GAP);
+		bool start(UBaseType_t priority = 1);	// again : starts the buses added since
+		bool getResult(mbResult &res);		// call from application task only
+		uint32_t dropped(int bus);			// results lost because queue was full
+		uint32_t cycles(int bus);			// finished poll cycles
+		
+	private:
+		struct mbBus {
+			CprE_modbusRTU rtu;
+			mbPoint* points;
+			int n;
+			unsigned long period;
+			int core;
+			uint8_t gap;
+			uint8_t id;
+			TaskHandle_t task;
+			volatile uint32_t dropped;
+			volatile uint32_t cycles;
+			CprE_spscQueue<mbResult, MB_BUS_RESULTS> results;
+		};
+		mbBus _bus[MB_MAX_BUS];
+		uint8_t _nbus = 0;
+		uint8_t _next = 0;		// bus to read first in next getResult()
+		
+		static void worker(void* arg);
+};
+
+#endif
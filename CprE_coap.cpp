@@ -0,0 +1,251 @@
+#include "CprE_coap.h"
+
+void CprE_coap::begin(CprE_NB_bc95 &modem, const char* ip, const char* port) {
+	_modem = &modem;
+	_ip = ip;
+	_port = port;
+	_mid = random(0x10000);
+	_modem->onURC("+NSONMI:", onNSONMI, this);
+}
+
+void CprE_coap::onNSONMI(const char* line, void* arg) {
+	((CprE_coap*)arg)->_rxPending = true;
+}
+
+void CprE_coap::setRetry(unsigned long ackTimeout, uint8_t maxRetransmit) {
+	_ackTimeout = ackTimeout;
+	_maxRetransmit = maxRetransmit;
+}
+
+// option delta/length nibble and its extended bytes
+static uint8_t optNibble(uint16_t v, uint8_t* ext, uint8_t &n) {
+	if(v < 13) 
+		return v;
+	if(v < 269) {
+		ext[n++] = v - 13;
+		return 13;
+	}
+	ext[n++] = (v - 269) >> 8;
+	ext[n++] = (v - 269) & 0xFF;
+	return 14;
+}
+
+size_t CprE_coap::encode(uint8_t* buf, size_t size, uint8_t type, uint8_t code, uint16_t mid, 
+	const uint8_t* token, uint8_t tkl, const coapOption* opts, uint8_t nopts, 
+	const uint8_t* payload, size_t len) {
+	if(tkl > 8 || size < (size_t)COAP_HEADER_SIZE + tkl) 
+		return 0;
+	size_t n = 0;
+	buf[n++] = (COAP_VER << 6) | (type << 4) | tkl;
+	buf[n++] = code;
+	buf[n++] = mid >> 8;
+	buf[n++] = mid & 0xFF;
+	if(tkl) 
+		memcpy(buf + n, token, tkl);
+	n += tkl;
+	uint16_t last = 0;
+	for(uint8_t i=0; i<nopts; i++) {
+		uint8_t ext[4];
+		uint8_t e = 0;
+		uint8_t d = optNibble(opts[i].number - last, ext, e);
+		uint8_t l = optNibble(opts[i].length, ext, e);
+		if(n + COAP_OPTION_HEADER_SIZE + e + opts[i].length > size) 
+			return 0;
+		buf[n++] = (d << 4) | l;
+		memcpy(buf + n, ext, e);
+		n += e;
+		memcpy(buf + n, opts[i].value, opts[i].length);
+		n += opts[i].length;
+		last = opts[i].number;
+	}
+	if(len > 0) {
+		if(n + 1 + len > size) 
+			return 0;
+		buf[n++] = COAP_PAYLOAD_MARKER;
+		memcpy(buf + n, payload, len);
+		n += len;
+	}
+	return n;
+}
+
+// read the datagrams the modem holds, one +NSONMI may stand for several
+// (e.g. an empty ACK then the separate response). Returns the response
+// code when one completes the exchange, -1 otherwise
+int CprE_coap::receive(uint16_t mid, bool &acked) {
+	_modem->process();
+	if(!_rxPending) 
+		return -1;
+	_rxPending = false;
+	int n;
+	while((n = _modem->receiveUDP(_rx, sizeof(_rx))) > 0) {
+		int r = parse(n, mid, acked);
+		if(r >= 0) {
+			_rxPending = true;		// read what is left on the next call
+			return r;
+		}
+	}
+	return -1;
+}
+
+// one datagram in _rx. acked is set by an empty ACK (separate response)
+int CprE_coap::parse(int n, uint16_t mid, bool &acked) {
+	if(n < COAP_HEADER_SIZE || (_rx[0] >> 6) != COAP_VER) 
+		return -1;
+	uint8_t type = (_rx[0] >> 4) & 0x03;
+	uint8_t tkl = _rx[0] & 0x0F;
+	uint8_t code = _rx[1];
+	uint16_t rmid = (_rx[2] << 8) | _rx[3];
+	if(tkl > 8 || COAP_HEADER_SIZE + tkl > n) 
+		return -1;
+	
+	if(type == COAP_TYPE_RESET) 
+		return rmid == mid ? 0 : -1;
+	if(type == COAP_TYPE_ACK && rmid == mid && code == 0) {
+		acked = true;
+		return -1;
+	}
+	bool ours = tkl == COAP_TOKEN_LEN && memcmp(_rx + COAP_HEADER_SIZE, _token, COAP_TOKEN_LEN) == 0;
+	if(!ours || (type == COAP_TYPE_ACK && rmid != mid)) 
+		return -1;
+	if(type == COAP_TYPE_CON) {
+		// separate response, confirm it
+		uint8_t ack[COAP_HEADER_SIZE];
+		encode(ack, sizeof(ack), COAP_TYPE_ACK, 0, rmid, NULL, 0, NULL, 0, NULL, 0);
+		_modem->sendUDP(_ip, _port, ack, sizeof(ack));
+	}
+	
+	// skip options, keep payload
+	int p = COAP_HEADER_SIZE + tkl;
+	_payload = NULL;
+	_payloadLen = 0;
+	while(p < n && _rx[p] != COAP_PAYLOAD_MARKER) {
+		uint8_t d = _rx[p] >> 4;
+		uint16_t l = _rx[p] & 0x0F;
+		p++;
+		if(d == 13) p += 1; else if(d == 14) p += 2;
+		// extended length bytes, only from inside the datagram
+		if(l == 13) {
+			if(p >= n) { p = n; break; }
+			l = _rx[p] + 13;
+			p += 1;
+		}
+		else if(l == 14) {
+			if(p + 1 >= n) { p = n; break; }
+			l = ((_rx[p] << 8) | _rx[p+1]) + 269;
+			p += 2;
+		}
+		p += l;
+	}
+	if(p < n - 1) {
+		_payload = _rx + p + 1;
+		_payloadLen = n - p - 1;
+	}
+	return code;
+}
+
+uint8_t CprE_coap::exchange(size_t len, uint16_t mid) {
+	unsigned long timeout = _ackTimeout;
+	bool acked = false;
+	_retries = 0;
+	_modem->sendUDP(_ip, _port, _buf, len);
+	while(true) {
+		unsigned long start = millis();
+		while(millis() - start < timeout) {
+			int r = receive(mid, acked);
+			if(r >= 0) 
+				return r;
+			delay(10);
+		}
+		timeout *= 2;
+		if(acked) {
+			// separate response, keep waiting without resending
+			if(timeout > _ackTimeout << _maxRetransmit) 
+				return 0;
+		}
+		else {
+			if(_retries >= _maxRetransmit) 
+				return 0;
+			_retries++;
+			_modem->sendUDP(_ip, _port, _buf, len);
+		}
+	}
+}
+
+uint8_t CprE_coap::send(uint8_t code, const char* path, const uint8_t* payload, size_t len, int format, int32_t block) {
+	coapOption opts[MAX_OPTION_NUM];
+	uint8_t nopts = 0;
+	// Uri-Path, one option per segment
+	const char* s = path;
+	while(*s && nopts < MAX_OPTION_NUM - 2) {
+		if(*s == '/') {
+			s++;
+			continue;
+		}
+		const char* e = strchr(s, '/');
+		uint16_t l = e ? e - s : strlen(s);
+		opts[nopts++] = {COAP_OPT_URI_PATH, (const uint8_t*)s, l};
+		s += l;
+	}
+	// uint options are sent big endian without leading zero bytes
+	uint8_t fmt[2] = {(uint8_t)(format >> 8), (uint8_t)format};
+	if(format >= 0) {
+		uint8_t l = format > 0xFF ? 2 : format ? 1 : 0;
+		opts[nopts++] = {COAP_OPT_CONTENT_FORMAT, fmt + 2 - l, l};
+	}
+	uint8_t blk[3] = {(uint8_t)(block >> 16), (uint8_t)(block >> 8), (uint8_t)block};
+	if(block >= 0) {
+		uint8_t l = block > 0xFFFF ? 3 : block > 0xFF ? 2 : block ? 1 : 0;
+		opts[nopts++] = {COAP_OPT_BLOCK1, blk + 3 - l, l};
+	}
+	
+	uint16_t mid = _mid++;
+	for(uint8_t i=0; i<COAP_TOKEN_LEN; i++) 
+		_token[i] = random(0x100);
+	size_t n = encode(_buf, sizeof(_buf), COAP_TYPE_CON, code, mid, _token, COAP_TOKEN_LEN, opts, nopts, payload, len);
+	if(n == 0) 
+		return 0;
+	return exchange(n, mid);
+}
+
+uint8_t CprE_coap::request(uint8_t code, const char* path, const uint8_t* payload, size_t len, int format) {
+	if(len <= COAP_BLOCK_SIZE) 
+		return send(code, path, payload, len, format, -1);
+	// Block1 : NUM | M | SZX, SZX = log2(size) - 4
+	uint8_t szx = 0;
+	while((16 << szx) < COAP_BLOCK_SIZE) 
+		szx++;
+	uint8_t r = 0;
+	for(uint32_t num = 0; num * COAP_BLOCK_SIZE < len; num++) {
+		size_t off = num * COAP_BLOCK_SIZE;
+		size_t l = min((size_t)COAP_BLOCK_SIZE, len - off);
+		bool more = off + l < len;
+		r = send(code, path, payload + off, l, format, (num << 4) | (more << 3) | szx);
+		if(more && r != COAP_CONTINUE) 
+			return r;
+	}
+	return r;
+}
+
+uint8_t CprE_coap::get(const char* path) {
+	return request(COAP_GET, path, NULL, 0);
+}
+
+uint8_t CprE_coap::post(const char* path, const uint8_t* payload, size_t len, int format) {
+	return request(COAP_POST, path, payload, len, format);
+}
+
+uint8_t CprE_coap::put(const char* path, const uint8_t* payload, size_t len, int format) {
+	return request(COAP_PUT, path, payload, len, format);
+}
+
+const uint8_t* CprE_coap::payload() {
+	return _payload;
+}
+
+size_t CprE_coap::payloadLength() {
+	return _payloadLen;
+}
+
+uint8_t CprE_coap::retransmissions() {
+	return _retries;
+}
@@ -0,0 +1,73 @@
+#ifndef CPRE_COAP_H
+#define CPRE_COAP_H
+
+#include <Arduino.h>
+#include "CprE_NB_bc95.h"
+
+#define COAP_ACK_TIMEOUT	2000	// ms before first retransmission (RFC 7252)
+#define COAP_MAX_RETRANSMIT	4		// timeout doubles on every retry
+#define COAP_BLOCK_SIZE		256		// block-wise size, power of 2 from 16 to 1024
+#define COAP_TOKEN_LEN		4
+#define COAP_BUF_SIZE		MODEM_UDP_MAX
+
+#define COAP_OPT_URI_PATH		11
+#define COAP_OPT_CONTENT_FORMAT	12
+#define COAP_OPT_BLOCK1			27
+
+#define COAP_CODE(c, d)		(((c) << 5) | (d))
+#define COAP_CONTINUE		COAP_CODE(2, 31)	// 2.31, send next block
+
+struct coapOption {
+	uint16_t number;
+	const uint8_t* value;
+	uint16_t length;
+};
+
+// Confirmable CoAP requests over the BC95 UDP socket. A request is resent
+// with doubling timeout until the matching ACK (or a RST) arrives, replies
+// are fetched with AT+NSORF when the modem reports +NSONMI. Payloads larger
+// than COAP_BLOCK_SIZE go out block by block with the Block1 option.
+// Methods return the response code, e.g. COAP_CODE(2,4), or 0 on failure.
+class CprE_coap {
+	public:
+		void begin(CprE_NB_bc95 &modem, const char* ip, const char* port = "5683");
+		void setRetry(unsigned long ackTimeout, uint8_t maxRetransmit);
+		
+		uint8_t get(const char* path);
+		uint8_t post(const char* path, const uint8_t* payload, size_t len, int format = -1);
+		uint8_t put(const char* path, const uint8_t* payload, size_t len, int format = -1);
+		uint8_t request(uint8_t code, const char* path, const uint8_t* payload, size_t len, int format = -1);
+		
+		// payload of the last response
+		const uint8_t* payload();
+		size_t payloadLength();
+		uint8_t retransmissions();	// in the last request
+		
+		// message into buf, options sorted by number. Returns length, 0 if too big
+		static size_t encode(uint8_t* buf, size_t size, uint8_t type, uint8_t code, uint16_t mid, 
+			const uint8_t* token, uint8_t tkl, const coapOption* opts, uint8_t nopts, 
+			const uint8_t* payload, size_t len);
+		
+	private:
+		CprE_NB_bc95* _modem;
+		const char* _ip;
+		const char* _port;
+		unsigned long _ackTimeout = COAP_ACK_TIMEOUT;
+		uint8_t _maxRetransmit = COAP_MAX_RETRANSMIT;
+		uint16_t _mid;
+		uint8_t _token[COAP_TOKEN_LEN];
+		volatile bool _rxPending = false;
+		uint8_t _buf[COAP_BUF_SIZE];
+		uint8_t _rx[COAP_BUF_SIZE];
+		const uint8_t* _payload = NULL;
+		size_t _payloadLen = 0;
+		uint8_t _retries = 0;
+		
+		uint8_t exchange(size_t len, uint16_t mid);
+		int receive(uint16_t mid, bool &acked);
+		int parse(int n, uint16_t mid, bool &acked);
+		uint8_t send(uint8_t code, const char* path, const uint8_t* payload, size_t len, int format, int32_t block);
+		static void onNSONMI(const char* line, void* arg);
+};
+
+#endif
@@ -0,0 +1,12 @@
+#include "CprE_crc16.h"
+
+#define CRC16_E4(n)		CprE_crc16::tableEntry(n), CprE_crc16::tableEntry(n+1), \
+						CprE_crc16::tableEntry(n+2), CprE_crc16::tableEntry(n+3)
+#define CRC16_E16(n)	CRC16_E4(n), CRC16_E4(n+4), CRC16_E4(n+8), CRC16_E4(n+12)
+#define CRC16_E64(n)	CRC16_E16(n), CRC16_E16(n+16), CRC16_E16(n+32), CRC16_E16(n+48)
+
+#ifdef CPRE_CRC16_NIBBLE
+const uint16_t CprE_crc16::table[16] = { CRC16_E16(0) };
+#else
+const uint16_t CprE_crc16::table[256] = { CRC16_E64(0), CRC16_E64(64), CRC16_E64(128), CRC16_E64(192) };
+#endif
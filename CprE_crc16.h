@@ -0,0 +1,85 @@
+#ifndef CPRE_CRC16_H
+#define CPRE_CRC16_H
+
+#include <Arduino.h>
+
+// CRC-16/MODBUS (poly 0xA001 reflected, init 0xFFFF)
+// Lookup table is generated at compile time and kept in flash.
+// Add -DCPRE_CRC16_NIBBLE to build flags to use a 16-entry table (32 bytes)
+// instead of the 256-entry table (512 bytes) on flash-constrained builds.
+
+// request frame with CRC, see CprE_crc16::readFrame()
+struct mbFrame {
+	uint8_t b[8];
+};
+
+class CprE_crc16 {
+	public:
+		CprE_crc16() : _crc(0xFFFF) {}
+		
+		// incremental : feed bytes as they arrive
+		void reset() { _crc = 0xFFFF; }
+		void update(uint8_t byteIn) { _crc = step(_crc, byteIn); }
+		void update(const uint8_t* data, int len) { _crc = compute(_crc, data, len); }
+		uint16_t value() const { return _crc; }
+		// CRC over a whole frame including its CRC bytes is 0
+		bool valid() const { return _crc == 0; }
+		
+		static uint16_t step(uint16_t crc, uint8_t byteIn) {
+#ifdef CPRE_CRC16_NIBBLE
+			crc = (crc >> 4) ^ table[(crc ^ byteIn) & 0x0F];
+			return (crc >> 4) ^ table[(crc ^ (byteIn >> 4)) & 0x0F];
+#else
+			return (crc >> 8) ^ table[(crc ^ byteIn) & 0xFF];
+#endif
+		}
+		
+		static uint16_t compute(uint16_t crc, const uint8_t* data, int len) {
+			for(int i=0; i<len; i++) {
+				crc = step(crc, data[i]);
+			}
+			return crc;
+		}
+		
+		static uint16_t compute(const uint8_t* data, int len) {
+			return compute(0xFFFF, data, len);
+		}
+		
+		// compile time : bitwise, only meant for constant expressions
+		static constexpr uint16_t shift(uint16_t crc, int bits) {
+			return bits == 0 ? crc : shift((crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1), bits-1);
+		}
+		
+		static constexpr uint16_t stepConst(uint16_t crc, uint8_t byteIn) {
+			return shift(crc ^ byteIn, 8);
+		}
+		
+		static constexpr uint16_t computeConst(const uint8_t* data, int len, uint16_t crc = 0xFFFF) {
+			return len == 0 ? crc : computeConst(data+1, len-1, stepConst(crc, data[0]));
+		}
+		
+		// FC01-04 read request, e.g.
+		// static constexpr mbFrame req = CprE_crc16::readFrame(1, 0x04, 0, 2);
+		static constexpr mbFrame readFrame(uint8_t SS, uint8_t func, uint16_t addr, uint16_t len) {
+			return withCrc(SS, func, addr >> 8, addr & 0xFF, len >> 8, len & 0xFF,
+				stepConst(stepConst(stepConst(stepConst(stepConst(stepConst(0xFFFF, 
+					SS), func), addr >> 8), addr & 0xFF), len >> 8), len & 0xFF));
+		}
+		
+#ifdef CPRE_CRC16_NIBBLE
+		static constexpr uint16_t tableEntry(uint16_t i) { return shift(i, 4); }
+		static const uint16_t table[16];
+#else
+		static constexpr uint16_t tableEntry(uint16_t i) { return shift(i, 8); }
+		static const uint16_t table[256];
+#endif
+		
+	private:
+		uint16_t _crc;
+		
+		static constexpr mbFrame withCrc(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5, uint16_t crc) {
+			return mbFrame{{b0, b1, b2, b3, b4, b5, (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8)}};
+		}
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include "CprE_logStore.h"
+
+#define LS_STATE_SIZE	(8 + LS_PATH_LEN + 2)	// magic, checkpoint, path, CRC
+
+static void put32(uint8_t* p, uint32_t v) {
+	for(uint8_t i=0; i<4; i++) 
+		p[i] = v >> (8 * i);
+}
+
+static uint32_t get32(const uint8_t* p) {
+	return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// CRC of a record header, the payload is added by the caller
+static uint16_t recordCrc(uint32_t pos, const uint8_t* head) {
+	uint8_t o[4];
+	put32(o, pos);
+	return CprE_crc16::compute(CprE_crc16::compute(o, 4), head, LS_RECORD_HEAD);
+}
+
+// name only, File::name() is the full path on older cores
+static const char* baseName(File &f) {
+	const char* n = f.name();
+	const char* s = strrchr(n, '/');
+	return s ? s + 1 : n;
+}
+
+static bool isSegment(const char* n) {
+	return strlen(n) == LS_NAME_LEN - 1 && n[8] == '-' && strcmp(n + 15, ".log") == 0;
+}
+
+bool CprE_logStore::firstSegment(fs::FS &fs, const char* dir, char* name, const char* after) {
+	File root = fs.open(dir);
+	if(!root || !root.isDirectory()) 
+		return false;
+	bool found = false;
+	for(File f = root.openNextFile(); f; f = root.openNextFile()) {
+		const char* n = baseName(f);
+		if(isSegment(n) && (!after || strcmp(n, after) > 0) && (!found || strcmp(n, name) < 0)) {
+			strcpy(name, n);
+			found = true;
+		}
+	}
+	return found;
+}
+
+bool CprE_logStore::lastSegment(fs::FS &fs, const char* dir, char* name) {
+	File root = fs.open(dir);
+	if(!root || !root.isDirectory()) 
+		return false;
+	bool found = false;
+	for(File f = root.openNextFile(); f; f = root.openNextFile()) {
+		const char* n = baseName(f);
+		if(isSegment(n) && (!found || strcmp(n, name) > 0)) {
+			strcpy(name, n);
+			found = true;
+		}
+	}
+	return found;
+}
+
+int32_t CprE_logStore::read(File &f, uint32_t &pos, uint8_t* buf, uint16_t size) {
+	uint8_t h[LS_RECORD_HEAD], c[2];
+	if(!f.seek(pos) || f.read(h, LS_RECORD_HEAD) != LS_RECORD_HEAD) 
+		return -1;
+	uint16_t len = h[0] | h[1] << 8;
+	if(len > size || f.read(buf, len) != len || f.read(c, 2) != 2) 
+		return -1;
+	uint16_t crc = CprE_crc16::compute(recordCrc(pos, h), buf, len);
+	if(crc != (c[0] | c[1] << 8)) 
+		return -1;
+	pos += LS_RECORD_HEAD + len + 2;
+	return len;
+}
+
+// end of the valid records from pos, payloads are checked in small chunks
+uint32_t CprE_logStore::scan(File &f, uint32_t pos, uint32_t count) {
+	uint32_t size = f.size();
+	uint8_t b[64];
+	while(count-- > 0 && pos + LS_RECORD_HEAD + 2 <= size) {
+		uint8_t h[LS_RECORD_HEAD];
+		if(!f.seek(pos) || f.read(h, LS_RECORD_HEAD) != LS_RECORD_HEAD) 
+			break;
+		uint16_t len = h[0] | h[1] << 8;
+		if(pos + LS_RECORD_HEAD + len + 2 > size) 
+			break;
+		uint16_t crc = recordCrc(pos, h);
+		for(uint16_t done=0; done<len; ) {
+			uint16_t n = len - done < sizeof(b) ? len - done : sizeof(b);
+			if(f.read(b, n) != n) 
+				return pos;
+			crc = CprE_crc16::compute(crc, b, n);
+			done += n;
+		}
+		if(f.read(b, 2) != 2 || crc != (b[0] | b[1] << 8)) 
+			break;
+		pos += LS_RECORD_HEAD + len + 2;
+	}
+	return pos;
+}
+
+bool CprE_logStore::loadState(uint32_t &checkpoint) {
+	char p[LS_PATH_LEN + 8];
+	snprintf(p, sizeof(p), "%s/state", _dir);
+	File f = _fs->open(p, FILE_READ);
+	uint8_t s[LS_STATE_SIZE];
+	if(!f || f.read(s, LS_STATE_SIZE) != LS_STATE_SIZE) 
+		return false;
+	f.close();
+	uint16_t crc = CprE_crc16::compute(s, LS_STATE_SIZE - 2);
+	if(get32(s) != LS_STATE_MAGIC || crc != (s[LS_STATE_SIZE - 2] | s[LS_STATE_SIZE - 1] << 8)) 
+		return false;
+	checkpoint = get32(s + 4);
+	memcpy(_path, s + 8, LS_PATH_LEN);
+	_path[LS_PATH_LEN - 1] = '\0';
+	return true;
+}
+
+void CprE_logStore::saveState() {
+	char p[LS_PATH_LEN + 8];
+	snprintf(p, sizeof(p), "%s/state", _dir);
+	uint8_t s[LS_STATE_SIZE] = {0};
+	put32(s, LS_STATE_MAGIC);
+	put32(s + 4, _checkpoint);
+	strncpy((char*)s + 8, _path, LS_PATH_LEN - 1);
+	uint16_t crc = CprE_crc16::compute(s, LS_STATE_SIZE - 2);
+	s[LS_STATE_SIZE - 2] = crc;
+	s[LS_STATE_SIZE - 1] = crc >> 8;
+	File f = _fs->open(p, FILE_WRITE);
+	if(f) {
+		f.write(s, LS_STATE_SIZE);
+		f.close();
+	}
+}
+
+// new segment named from the DS3231, a second later if the name is taken
+bool CprE_logStore::open() {
+	_log.end();
+	uint32_t t = _rtc->now().unixtime();
+	do {
+		DateTime d(t++);
+		snprintf(_path, sizeof(_path), "%s/%04d%02d%02d-%02d%02d%02d.log", _dir,
+			d.year(), d.month(), d.day(), d.hour(), d.minute(), d.second());
+	} while(_fs->exists(_path));
+	if(!_log.begin(*_fs, _path)) 
+		return false;
+	_checkpoint = 0;
+	_opened = millis();
+	_rollIn = (86400 - (t - 1) % 86400) * 1000UL;
+	saveState();
+	return true;
+}
+
+bool CprE_logStore::begin(fs::FS &fs, const char* dir, CprE_DS3231 &rtc) {
+	_fs = &fs;
+	_rtc = &rtc;
+	strncpy(_dir, dir, LS_PATH_LEN - LS_NAME_LEN - 1);
+	_dir[LS_PATH_LEN - LS_NAME_LEN - 1] = '\0';
+	_recovered = 0;
+	fs.mkdir(_dir);
+	uint32_t checkpoint;
+	if(!loadState(checkpoint)) {
+		// no state : the newest segment, checked from its start
+		char name[LS_NAME_LEN];
+		if(!lastSegment(fs, _dir, name)) 
+			return open();
+		snprintf(_path, sizeof(_path), "%s/%s", _dir, name);
+		checkpoint = 0;
+	}
+	File f = fs.open(_path, FILE_READ);
+	if(!f) 
+		return open();
+	uint32_t size = f.size();
+	uint32_t end = scan(f, checkpoint <= size ? checkpoint : 0);
+	f.close();
+	_recovered = size - end;
+	// the date part of the name against today
+	DateTime now = rtc.now();
+	char today[9];
+	snprintf(today, sizeof(today), "%04d%02d%02d", now.year(), now.month(), now.day());
+	const char* name = _path + strlen(_dir) + 1;
+	if(_recovered > 0 || end >= _maxSize || (_daily && strncmp(name, today, 8) != 0)) 
+		return open();
+	if(!_log.begin(fs, _path)) 
+		return false;
+	_checkpoint = end;
+	_opened = millis();
+	_rollIn = (86400 - now.unixtime() % 86400) * 1000UL;
+	return true;
+}
+
+void CprE_logStore::setRotation(bool daily, uint32_t maxSize) {
+	_daily = daily;
+	_maxSize = maxSize;
+}
+
+void CprE_logStore::setRetention(uint64_t minFree, lsFreeBytes freeBytes) {
+	_minFree = minFree;
+	_freeBytes = freeBytes;
+}
+
+bool CprE_logStore::append(const uint8_t* data, uint16_t len) {
+	uint32_t pos = _log.size();
+	if((_daily && millis() - _opened >= _rollIn) || (pos > 0 && pos + LS_RECORD_HEAD + len + 2 > _maxSize)) {
+		if(!open()) 
+			return false;
+		pos = 0;
+	}
+	uint8_t h[LS_RECORD_HEAD] = {(uint8_t)len, (uint8_t)(len >> 8)};
+	uint16_t crc = CprE_crc16::compute(recordCrc(pos, h), data, len);
+	uint8_t c[2] = {(uint8_t)crc, (uint8_t)(crc >> 8)};
+	// in order, the first short write ends the record
+	if(_log.write(h, LS_RECORD_HEAD) != LS_RECORD_HEAD || _log.write(data, len) != len || _log.write(c, 2) != 2) {
+		// the part written stays in the segment : close it there, so a torn
+		// record is only ever at the tail of a segment, where scan() stops
+		open();
+		return false;
+	}
+	if(_log.size() - _checkpoint >= LS_CHECKPOINT) 
+		sync();
+	return true;
+}
+
+bool CprE_logStore::append(const char* text) {
+	return append((const uint8_t*)text, strlen(text));
+}
+
+bool CprE_logStore::sync() {
+	if(!_log.sync()) 
+		return false;
+	if(_log.size() - _checkpoint >= LS_CHECKPOINT) {
+		_checkpoint = _log.size();
+		saveState();
+	}
+	return true;
+}
+
+void CprE_logStore::service() {
+	_log.service();
+	if(!_freeBytes || millis() - _lastCheck < LS_RETENTION) 
+		return;
+	_lastCheck = millis();
+	char name[LS_NAME_LEN];
+	char path[LS_PATH_LEN];
+	while(_freeBytes() < _minFree && firstSegment(*_fs, _dir, name)) {
+		snprintf(path, sizeof(path), "%s/%s", _dir, name);
+		if(strcmp(path, _path) == 0 || !_fs->remove(path)) 
+			break;		// only the active segment is left
+		_removed++;
+	}
+}
+
+const char* CprE_logStore::directory() {
+	return _dir;
+}
+
+const char* CprE_logStore::segment() {
+	return _path;
+}
+
+uint32_t CprE_logStore::offset() {
+	return _log.size();
+}
+
+uint32_t CprE_logStore::recovered() {
+	return _recovered;
+}
+
+uint32_t CprE_logStore::removed() {
+	return _removed;
+}
@@ -0,0 +1,82 @@
+#ifndef CPRE_LOG_STORE_H
+#define CPRE_LOG_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "CprE_crc16.h"
+#include "CprE_DS3231.h"
+#include "CprE_logWriter.h"
+
+#define LS_STATE_MAGIC	0x31534C47	// "GLS1"
+#define LS_SEGMENT_MAX	1048576		// bytes before a size rotation
+#define LS_CHECKPOINT	65536		// bytes between state saves, bounds the boot scan
+#define LS_RETENTION	60000		// ms between free space checks
+#define LS_PATH_LEN		48
+#define LS_NAME_LEN		20			// "YYYYMMDD-hhmmss.log" + '\0'
+#define LS_RECORD_HEAD	2			// length, the CRC16 follows the payload
+
+typedef uint64_t (*lsFreeBytes)();
+
+// Segmented log : records go to segment files named from the DS3231 time
+// they were opened, <dir>/YYYYMMDD-hhmmss.log, so names sort by age. A
+// new segment starts at midnight (setRotation) or once the current one
+// reaches maxSize. Each record is [len][payload][CRC16], the Modbus CRC
+// taken over the file offset, len and payload, so a torn or stale record
+// never checks.
+// Boot recovery reads the small state file <dir>/state : active segment
+// and a checkpoint offset, saved every LS_CHECKPOINT bytes. Only records
+// after the checkpoint are checked, whatever the history on the card. A
+// segment with a torn tail is left as it is (readers stop at the first
+// bad record) and logging goes on in a new segment. A short write at run
+// time does the same, so a bad record is only ever the last of a segment.
+// Retention deletes the oldest segments while freeBytes() is below minFree.
+class CprE_logStore {
+	public:
+		bool begin(fs::FS &fs, const char* dir, CprE_DS3231 &rtc);
+		void setRotation(bool daily, uint32_t maxSize = LS_SEGMENT_MAX);
+		void setRetention(uint64_t minFree, lsFreeBytes freeBytes);
+
+		bool append(const uint8_t* data, uint16_t len);
+		bool append(const char* text);
+		void service();			// call from loop()
+		bool sync();
+
+		const char* directory();
+		const char* segment();	// path of the active segment
+		uint32_t offset();		// where the next record goes
+		uint32_t recovered();	// torn bytes left behind at begin()
+		uint32_t removed();		// segments deleted by retention
+
+		// next valid record of a segment at pos, pos moves past it.
+		// Returns the length or -1 at the end or a bad record
+		static int32_t read(File &f, uint32_t &pos, uint8_t* buf, uint16_t size);
+		// first (oldest) segment name after the given one, or the last
+		// (newest), into name[LS_NAME_LEN]
+		static bool firstSegment(fs::FS &fs, const char* dir, char* name, const char* after = NULL);
+		static bool lastSegment(fs::FS &fs, const char* dir, char* name);
+		// end of the valid records from pos, at most count of them
+		static uint32_t scan(File &f, uint32_t pos, uint32_t count = 0xFFFFFFFF);
+
+	private:
+		fs::FS* _fs;
+		CprE_DS3231* _rtc;
+		CprE_logWriter _log;
+		char _dir[LS_PATH_LEN];
+		char _path[LS_PATH_LEN];
+		uint32_t _checkpoint = 0;
+		uint32_t _recovered = 0;
+		uint32_t _removed = 0;
+		bool _daily = true;
+		uint32_t _maxSize = LS_SEGMENT_MAX;
+		unsigned long _opened;
+		unsigned long _rollIn;		// ms from _opened to midnight
+		uint64_t _minFree = 0;
+		lsFreeBytes _freeBytes = NULL;
+		unsigned long _lastCheck = 0;
+
+		bool open();
+		bool loadState(uint32_t &checkpoint);
+		void saveState();
+};
+
+#endif
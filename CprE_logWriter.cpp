@@ -0,0 +1,98 @@
+#include "CprE_logWriter.h"
+
+bool CprE_logWriter::begin(fs::FS &fs, const char* path, unsigned long age) {
+	end();
+	_file = fs.open(path, FILE_APPEND);
+	if(!_file) 
+		return false;
+	_pos = _file.size();
+	_room = LOG_SECTOR - _pos % LOG_SECTOR;
+	_len = 0;
+	_age = age;
+	_unsynced = false;
+	_writes = 0;
+	_syncs = 0;
+	return true;
+}
+
+void CprE_logWriter::end() {
+	if(!_file) 
+		return;
+	drain();
+	_file.close();
+}
+
+// write the buffer, a short write keeps the rest for the next try
+bool CprE_logWriter::drain() {
+	if(_len == 0) 
+		return true;
+	size_t n = _file.write(_buf, _len);
+	_writes++;
+	_pos += n;
+	_room = LOG_SECTOR - _pos % LOG_SECTOR;
+	_len -= n;
+	if(_len > 0) {
+		memmove(_buf, _buf + n, _len);
+		return false;
+	}
+	return true;
+}
+
+size_t CprE_logWriter::write(uint8_t c) {
+	return write(&c, 1);
+}
+
+size_t CprE_logWriter::write(const uint8_t* data, size_t len) {
+	if(!_file) 
+		return 0;
+	if(!_unsynced && len > 0) {
+		_unsynced = true;
+		_since = millis();
+	}
+	size_t done = 0;
+	while(done < len) {
+		if(_len >= _room && !drain()) 
+			break;
+		size_t n = _room - _len;
+		if(n > len - done) 
+			n = len - done;
+		memcpy(_buf + _len, data + done, n);
+		_len += n;
+		done += n;
+		if(_len == _room) 
+			drain();
+	}
+	return done;
+}
+
+void CprE_logWriter::service() {
+	if(_unsynced && millis() - _since >= _age) 
+		sync();
+}
+
+bool CprE_logWriter::sync() {
+	if(!_file) 
+		return false;
+	bool ok = drain();
+	_file.flush();
+	_syncs++;
+	_unsynced = _len > 0;
+	_since = millis();
+	return ok;
+}
+
+uint32_t CprE_logWriter::size() {
+	return _pos + _len;
+}
+
+uint32_t CprE_logWriter::writes() {
+	return _writes;
+}
+
+uint32_t CprE_logWriter::syncs() {
+	return _syncs;
+}
+
+CprE_logWriter::operator bool() {
+	return (bool)_file;
+}
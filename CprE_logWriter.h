@@ -0,0 +1,48 @@
+#ifndef CPRE_LOG_WRITER_H
+#define CPRE_LOG_WRITER_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define LOG_SECTOR	512			// SD sector, unit of the file writes
+#define LOG_AGE		10000		// ms unsynced data may wait before sync
+
+// Append-only log that keeps the file open. print()/write() go to a one
+// sector RAM buffer which is written when it reaches the next sector
+// boundary of the file, so the card sees whole aligned sectors and no FAT
+// lookup or directory update per line. sync() writes what is pending and
+// commits the file size to the directory, service() does it once data is
+// older than age : that is the most a power cut can lose.
+class CprE_logWriter : public Print {
+	public:
+		bool begin(fs::FS &fs, const char* path, unsigned long age = LOG_AGE);
+		void end();
+
+		size_t write(uint8_t c);
+		size_t write(const uint8_t* data, size_t len);
+		using Print::write;
+
+		void service();			// call from loop()
+		bool sync();
+
+		uint32_t size();		// file size, pending bytes included
+		uint32_t writes();		// file writes since begin()
+		uint32_t syncs();
+		operator bool();
+
+	private:
+		File _file;
+		uint8_t _buf[LOG_SECTOR];
+		uint16_t _len = 0;
+		uint16_t _room = LOG_SECTOR;	// bytes to the next sector boundary
+		uint32_t _pos = 0;
+		unsigned long _age = LOG_AGE;
+		unsigned long _since = 0;		// first unsynced byte
+		bool _unsynced = false;
+		uint32_t _writes = 0;
+		uint32_t _syncs = 0;
+
+		bool drain();
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef CPRE_MB_CODEC_H
+#define CPRE_MB_CODEC_H
+
+#include <Arduino.h>
+
+// word/byte order of values longer than 1 register
+// (A = most significant byte)
+enum mbOrder : uint8_t {
+	MB_ABCD = 0,	// big endian, Modbus standard (SDM120, CORUS)
+	MB_BADC = 1,	// bytes swapped in each register
+	MB_CDAB = 2,	// registers swapped (S7-1200 and many PLCs)
+	MB_DCBA = 3		// little endian
+};
+#define MB_ORDER_BYTESWAP	0x01
+#define MB_ORDER_WORDSWAP	0x02
+
+template <uint8_t N> struct mbRaw;
+template <> struct mbRaw<2> { typedef uint16_t type; };
+template <> struct mbRaw<4> { typedef uint32_t type; };
+template <> struct mbRaw<8> { typedef uint64_t type; };
+
+// Decoder/encoder of one value type in one register order.
+// Byte positions are compile-time constants, so each order compiles
+// down to its own fixed shuffle (plain copy for DCBA on the ESP32).
+// <p> points to the first byte of the first register.
+template <mbOrder ORDER, typename T>
+struct mbCodec {
+	static const uint8_t size = sizeof(T);		// bytes
+	static const uint8_t regs = sizeof(T)/2;	// registers
+	
+	// position in frame of k-th most significant byte
+	static constexpr uint8_t src(uint8_t k) {
+		return 2*((ORDER & MB_ORDER_WORDSWAP)? regs-1-k/2 : k/2) + ((ORDER & MB_ORDER_BYTESWAP)? 1-k%2 : k%2);
+	}
+	
+	static T decode(const uint8_t* p) {
+		T val;
+		if(ORDER == MB_DCBA) {
+			memcpy(&val, p, size);					// frame order = memory order
+			return val;
+		}
+		typename mbRaw<sizeof(T)>::type raw = 0;
+		for(uint8_t k=0; k<size; k++) {
+			raw = (raw << 8) | p[src(k)];
+		}
+		memcpy(&val, &raw, size);
+		return val;
+	}
+	
+	static void encode(T val, uint8_t* p) {
+		if(ORDER == MB_DCBA) {
+			memcpy(p, &val, size);
+			return;
+		}
+		typename mbRaw<sizeof(T)>::type raw;
+		memcpy(&raw, &val, size);
+		for(uint8_t k=0; k<size; k++) {
+			p[src(k)] = raw >> (8*(size-1-k));
+		}
+	}
+	
+	// decode <count> consecutive values of a register block into <out>
+	static void decodeBlock(const uint8_t* p, T* out, int count) {
+		for(int i=0; i<count; i++) {
+			out[i] = decode(p + i*size);
+		}
+	}
+	
+	static void encodeBlock(const T* in, uint8_t* p, int count) {
+		for(int i=0; i<count; i++) {
+			encode(in[i], p + i*size);
+		}
+	}
+};
+
+typedef mbCodec<MB_ABCD, float>    mbFloatABCD;
+typedef mbCodec<MB_CDAB, float>    mbFloatCDAB;
+typedef mbCodec<MB_ABCD, int32_t>  mbInt32ABCD;
+typedef mbCodec<MB_CDAB, int32_t>  mbInt32CDAB;
+typedef mbCodec<MB_ABCD, uint32_t> mbUint32ABCD;
+typedef mbCodec<MB_CDAB, uint32_t> mbUint32CDAB;
+typedef mbCodec<MB_ABCD, double>   mbDoubleABCD;
+typedef mbCodec<MB_ABCD, int64_t>  mbInt64ABCD;
+
+#endif
@@ -0,0 +1,188 @@
+#include "CprE_mbProfile.h"
+
+/******************** Profiles ********************/
+
+static constexpr mbProfilePoint sdm120ct[] = {
+	{"voltage",         0x04,   0, MB_FLOAT, MB_ABCD, 1, "V"},
+	{"current",         0x04,   6, MB_FLOAT, MB_ABCD, 1, "A"},
+	{"activePower",     0x04,  12, MB_FLOAT, MB_ABCD, 1, "W"},
+	{"apparentPower",   0x04,  18, MB_FLOAT, MB_ABCD, 1, "VA"},
+	{"reactivePower",   0x04,  24, MB_FLOAT, MB_ABCD, 1, "VAr"},
+	{"powerFactor",     0x04,  30, MB_FLOAT, MB_ABCD, 1, ""},
+	{"phaseAngle",      0x04,  36, MB_FLOAT, MB_ABCD, 1, "deg"},
+	{"frequency",       0x04,  70, MB_FLOAT, MB_ABCD, 1, "Hz"},
+	{"importActive",    0x04,  72, MB_FLOAT, MB_ABCD, 1, "kWh"},
+	{"exportActive",    0x04,  74, MB_FLOAT, MB_ABCD, 1, "kWh"},
+	{"importReactive",  0x04,  76, MB_FLOAT, MB_ABCD, 1, "kVArh"},
+	{"exportReactive",  0x04,  78, MB_FLOAT, MB_ABCD, 1, "kVArh"},
+	{"totalActive",     0x04, 342, MB_FLOAT, MB_ABCD, 1, "kWh"},
+	{"totalReactive",   0x04, 344, MB_FLOAT, MB_ABCD, 1, "kVArh"}
+};
+
+static constexpr mbProfilePoint ygc_fs[] = {
+	{"windSpeed",       0x03,   0, MB_UINT16, MB_ABCD, 0.1f, "m/s"}
+};
+
+static constexpr mbProfilePoint ygc_fx[] = {
+	{"windDirection",   0x03,   0, MB_UINT16, MB_ABCD, 1, "deg"}	// clockwise from south
+};
+
+static constexpr mbProfilePoint sx1_a31e[] = {
+	{"voltage",         0x03, 102, MB_UINT16, MB_ABCD, 0.01f, "V"},
+	{"frequency",       0x03, 105, MB_UINT16, MB_ABCD, 0.1f, "Hz"},
+	{"energy",          0x03, 110, MB_UINT32, MB_ABCD, 1, ""},
+	{"current",         0x03, 112, MB_UINT16, MB_ABCD, 0.01f, "A"},
+	{"power",           0x03, 115, MB_INT16,  MB_ABCD, 1, "W"}
+};
+
+static constexpr mbProfilePoint corus[] = {
+	{"battCounter",     0x03, 548, MB_UINT16, MB_ABCD, 1, ""},
+	{"unconvIndex",     0x03, 806, MB_UINT32, MB_ABCD, 1, "m3"},
+	{"convIndex",       0x03, 810, MB_UINT32, MB_ABCD, 1, "m3"},
+	{"instantT",        0x03, 834, MB_FLOAT,  MB_ABCD, 1, "C"},
+	{"instantP",        0x03, 836, MB_FLOAT,  MB_ABCD, 1, "bar"}
+};
+
+static constexpr mbProfilePoint s7_1200_ac[] = {
+	{"VoltA",           0x03,   0, MB_FLOAT, MB_ABCD, 1, "V"},
+	{"VoltB",           0x03,   2, MB_FLOAT, MB_ABCD, 1, "V"},
+	{"VoltC",           0x03,   4, MB_FLOAT, MB_ABCD, 1, "V"},
+	{"AmpA",            0x03,   6, MB_FLOAT, MB_ABCD, 1, "A"},
+	{"AmpB",            0x03,   8, MB_FLOAT, MB_ABCD, 1, "A"},
+	{"AmpC",            0x03,  10, MB_FLOAT, MB_ABCD, 1, "A"},
+	{"Wtotal",          0x03,  12, MB_FLOAT, MB_ABCD, 1, "W"},
+	{"kWh",             0x03,  14, MB_FLOAT, MB_ABCD, 1, "kWh"}
+};
+
+static constexpr mbProfilePoint s7_1200_dc[] = {
+	{"Volt",            0x03,   0, MB_FLOAT, MB_ABCD, 1, "V"},
+	{"Amp",             0x03,   2, MB_FLOAT, MB_ABCD, 1, "A"},
+	{"Watt",            0x03,   4, MB_FLOAT, MB_ABCD, 1, "W"},
+	{"kWh",             0x03,   6, MB_FLOAT, MB_ABCD, 1, "kWh"},
+	{"AmpHour",         0x03,   8, MB_FLOAT, MB_ABCD, 1, "Ah"}
+};
+
+static_assert(mbProfileSorted(sdm120ct) && mbProfileSorted(ygc_fs) && mbProfileSorted(ygc_fx)
+	&& mbProfileSorted(sx1_a31e) && mbProfileSorted(corus) && mbProfileSorted(s7_1200_ac)
+	&& mbProfileSorted(s7_1200_dc), "profile not sorted by function code and address");
+
+const mbProfile mbSDM120CT = MB_PROFILE("SDM120CT", sdm120ct);
+const mbProfile mbYGC_FS = MB_PROFILE("YGC-FS", ygc_fs);
+const mbProfile mbYGC_FX = MB_PROFILE("YGC-FX", ygc_fx);
+const mbProfile mbSX1_A31E = MB_PROFILE("SX1-A31E", sx1_a31e);
+const mbProfile mbCORUS = MB_PROFILE("CORUS", corus);
+const mbProfile mbS7_1200_AC = MB_PROFILE("S7-1200 AC", s7_1200_ac);
+const mbProfile mbS7_1200_DC = MB_PROFILE("S7-1200 DC", s7_1200_dc);
+
+/******************** Poll engine ********************/
+
+void CprE_mbPoller::begin(CprE_modbusRTU &rtu, mbDevice* devices, uint8_t n, uint8_t max_gap) {
+	_rtu = &rtu;
+	_devices = devices;
+	_n = n;
+	_gap = max_gap;
+	_failed = 0;
+}
+
+int CprE_mbPoller::poll() {
+	int requests = 0;
+	_failed = 0;
+	for(uint8_t i=0; i<_n; i++) {
+		requests += poll(_devices[i]);
+		if(_devices[i].error) 
+			_failed++;
+	}
+	return requests;
+}
+
+double CprE_mbPoller::decode(const CprE_mbView &v, uint8_t reg, const mbProfilePoint &p) {
+	mbOrder order = (mbOrder)p.order;
+	switch(p.type) {
+		case MB_INT16:
+			return v.i16(reg);
+		case MB_UINT16:
+			return v.u16(reg);
+		case MB_INT32:
+			return v.i32(reg, order);
+		case MB_UINT32:
+			return v.u32(reg, order);
+		case MB_INT64:
+			return v.i64(reg, order);
+		case MB_DOUBLE:
+			return v.f64(reg, order);
+		default:
+			return v.f32(reg, order);
+	}
+}
+
+// the table is sorted, so a block grows over the next points until the
+// function code changes, the gap is too wide or the request is full
+int CprE_mbPoller::poll(mbDevice &d) {
+	const mbProfile &p = *d.profile;
+	int requests = 0;
+	d.error = 0;
+	for(uint8_t i=0; i<p.count; ) {
+		uint8_t fc = p.points[i].func;
+		uint16_t lo = d.base + p.points[i].addr;
+		uint32_t hi = (uint32_t)lo + CprE_modbusRTU::regCount(p.points[i].type);
+		uint8_t j = i + 1;
+		for(; j<p.count; j++) {
+			const mbProfilePoint &q = p.points[j];
+			uint32_t a = d.base + q.addr;
+			uint32_t b = a + CprE_modbusRTU::regCount(q.type);
+			if(q.func != fc || a > hi + _gap || b - lo > MB_MAX_REGS) 
+				break;
+			if(b > hi) 
+				hi = b;
+		}
+
+		uint16_t len = hi - lo;
+		uint8_t err = 7;
+		if(fc == 0x03 || fc == 0x04) {
+			if(fc == 0x03) 
+				_rtu->sendReadHolding(d.slave, lo, len);
+			else 
+				_rtu->sendReadInput(d.slave, lo, len);
+			_rtu->recv(d.slave);
+			requests++;
+			err = _rtu->getError();
+		}
+		CprE_mbView v = _rtu->response();
+		if(!err && v.size() != 2*len) 
+			err = 3;						// DAMAGED PACKET
+		for(uint8_t k=i; k<j; k++) {
+			d.values[k] = err ? NAN : decode(v, d.base + p.points[k].addr - lo, p.points[k]) * p.points[k].scale;
+		}
+		if(err && !d.error) 
+			d.error = err;
+		i = j;
+	}
+	return requests;
+}
+
+uint8_t CprE_mbPoller::failed() {
+	return _failed;
+}
+
+void CprE_mbPoller::print(Print &out, const mbDevice &d, char sep) {
+	const mbProfile &p = *d.profile;
+	for(uint8_t i=0; i<p.count; i++) {
+		uint8_t dec = 0;
+		if(p.points[i].type == MB_FLOAT || p.points[i].type == MB_DOUBLE) 
+			dec = 2;
+		else {
+			for(float s = p.points[i].scale; s < 0.999f && dec < 6; s *= 10) 
+				dec++;
+		}
+		out.print(sep);
+		out.print(d.values[i], dec);
+	}
+}
+
+int CprE_mbPoller::find(const mbProfile &p, const char* name) {
+	for(uint8_t i=0; i<p.count; i++) {
+		if(strcmp(p.points[i].name, name) == 0) 
+			return i;
+	}
+	return -1;
+}
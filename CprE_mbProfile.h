@@ -0,0 +1,81 @@
+#ifndef CPRE_MB_PROFILE_H
+#define CPRE_MB_PROFILE_H
+
+#include <Arduino.h>
+#include "CprE_modbusRTU.h"
+
+// one register of a device, value = decoded raw * scale
+struct mbProfilePoint {
+	const char* name;
+	uint8_t  func;		// 0x03 (holding) or 0x04 (input)
+	uint16_t addr;		// register address, relative to mbDevice.base
+	uint8_t  type;		// mbType
+	uint8_t  order;		// mbOrder of 32/64-bit types
+	float    scale;
+	const char* unit;
+};
+
+// Register map of a device model. Tables are constexpr, so they stay in
+// flash, and sorted by function code then address : poll() merges close
+// points into one request in a single pass without any RAM plan.
+struct mbProfile {
+	const char* model;
+	const mbProfilePoint* points;
+	uint8_t count;
+};
+
+#define MB_PROFILE(model, points)	{model, points, sizeof(points)/sizeof(points[0])}
+
+// check a table at compile time :
+// static_assert(mbProfileSorted(points), "profile not sorted");
+template <size_t N>
+constexpr bool mbProfileSorted(const mbProfilePoint (&p)[N], size_t i = 1) {
+	return i >= N || ((p[i-1].func < p[i].func || (p[i-1].func == p[i].func && p[i-1].addr < p[i].addr))
+		&& mbProfileSorted(p, i + 1));
+}
+
+// one meter on the bus
+struct mbDevice {
+	uint8_t slave;
+	const mbProfile* profile;
+	// profile->count values, NAN when the read failed. Doubles keep 32-bit
+	// counters exact (CORUS indexes), 64-bit ones up to 2^53
+	double* values;
+	uint16_t base;		// added to the profile addresses (meters of one PLC)
+	uint8_t error;		// first error of the last poll, 0 when all read
+};
+
+// profiles shipped with the library, from the project register maps
+extern const mbProfile mbSDM120CT;		// Eastron SDM120CT, input floats
+extern const mbProfile mbYGC_FS;		// wind speed
+extern const mbProfile mbYGC_FX;		// wind direction
+extern const mbProfile mbSX1_A31E;		// single phase energy meter
+extern const mbProfile mbCORUS;			// Itron CORUS gas volume converter
+extern const mbProfile mbS7_1200_AC;	// Project8 PLC, AC meter at base 100, 200, ...
+extern const mbProfile mbS7_1200_DC;	// Project8 PLC, DC meter at base 600, 700, ...
+
+// Poll engine : reads every device of a site from its profile. A new
+// meter is a row in the device table, not new loop code.
+class CprE_mbPoller {
+	public:
+		void begin(CprE_modbusRTU &rtu, mbDevice* devices, uint8_t n, uint8_t max_gap = MB_PLAN_GAP);
+
+		int poll();					// all devices, return number of requests sent
+		int poll(mbDevice &d);
+		uint8_t failed();			// devices with an error in the last poll
+
+		// ",v1,v2,..." with decimals from the scales (2 for floats)
+		static void print(Print &out, const mbDevice &d, char sep = ',');
+		static int find(const mbProfile &p, const char* name);
+
+	private:
+		CprE_modbusRTU* _rtu;
+		mbDevice* _devices;
+		uint8_t _n = 0;
+		uint8_t _gap;
+		uint8_t _failed = 0;
+
+		static double decode(const CprE_mbView &v, uint8_t reg, const mbProfilePoint &p);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef CPRE_MB_VIEW_H
+#define CPRE_MB_VIEW_H
+
+#include <Arduino.h>
+#include "CprE_mbCodec.h"
+
+// Typed read-only view over data bytes of a response. Nothing is copied,
+// the view is valid until the next response is received into the buffer.
+// <reg> is a register offset from the first register of the response.
+// Reading outside the data returns 0.
+class CprE_mbView {
+	public:
+		CprE_mbView(const uint8_t* data = NULL, uint8_t len = 0) : _data(data), _len(len) {}
+		
+		const uint8_t* data() const { return _data; }
+		uint8_t size() const { return _len; }			// bytes
+		uint8_t regs() const { return _len/2; }			// registers
+		bool has(uint8_t reg, uint8_t count = 1) const { return 2*(reg+count) <= _len; }
+		
+		uint16_t u16(uint8_t reg) const {
+			return has(reg)? ((uint16_t)_data[2*reg] << 8) | _data[2*reg+1] : 0;
+		}
+		int16_t  i16(uint8_t reg) const { return (int16_t)u16(reg); }
+		
+		uint32_t u32(uint8_t reg, mbOrder order = MB_ABCD) const { return get<uint32_t>(reg, order); }
+		int32_t  i32(uint8_t reg, mbOrder order = MB_ABCD) const { return get<int32_t>(reg, order); }
+		float    f32(uint8_t reg, mbOrder order = MB_ABCD) const { return get<float>(reg, order); }
+		uint64_t u64(uint8_t reg, mbOrder order = MB_ABCD) const { return get<uint64_t>(reg, order); }
+		int64_t  i64(uint8_t reg, mbOrder order = MB_ABCD) const { return get<int64_t>(reg, order); }
+		double   f64(uint8_t reg, mbOrder order = MB_ABCD) const { return get<double>(reg, order); }
+		
+		// order known at compile time, e.g. v.get<MB_CDAB, float>(4)
+		template <mbOrder ORDER, typename T>
+		T get(uint8_t reg) const {
+			return has(reg, sizeof(T)/2)? mbCodec<ORDER, T>::decode(_data + 2*reg) : T();
+		}
+		
+		// decode <count> values starting at <reg> into <out>, return number decoded
+		template <mbOrder ORDER, typename T>
+		int getBlock(uint8_t reg, T* out, int count) const {
+			int avail = has(reg)? (regs()-reg) / (sizeof(T)/2) : 0;
+			if(count > avail) 
+				count = avail;
+			mbCodec<ORDER, T>::decodeBlock(_data + 2*reg, out, count);
+			return count;
+		}
+		
+		template <typename T>
+		T get(uint8_t reg, mbOrder order) const {
+			switch(order) {
+				case MB_BADC: return get<MB_BADC, T>(reg);
+				case MB_CDAB: return get<MB_CDAB, T>(reg);
+				case MB_DCBA: return get<MB_DCBA, T>(reg);
+				default:      return get<MB_ABCD, T>(reg);
+			}
+		}
+		
+	private:
+		const uint8_t* _data;
+		uint8_t _len;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "CprE_mbWriteBatch.h"
+
+bool CprE_mbWriteBatch::add(uint8_t SS, uint16_t addr, uint16_t value) {
+	for(uint8_t i=0; i<_n; i++) {
+		if(_w[i].slave == SS && _w[i].addr == addr) {
+			_w[i].value = value;
+			return true;
+		}
+	}
+	if(_n >= MB_BATCH_SIZE) 
+		return false;
+	_w[_n].slave = SS;
+	_w[_n].addr = addr;
+	_w[_n].value = value;
+	_n++;
+	return true;
+}
+
+int CprE_mbWriteBatch::flush(CprE_modbusRTU &rtu) {
+	// sort by slave, address (insertion sort, list is short)
+	for(uint8_t i=1; i<_n; i++) {
+		mbWrite w = _w[i];
+		int8_t j = i-1;
+		while(j >= 0 && (_w[j].slave > w.slave || (_w[j].slave == w.slave && _w[j].addr > w.addr))) {
+			_w[j+1] = _w[j];
+			j--;
+		}
+		_w[j+1] = w;
+	}
+	
+	int frames = 0;
+	_failed = 0;
+	uint8_t i = 0;
+	while(i < _n) {
+		// run of adjacent registers on same slave
+		uint8_t len = 1;
+		while(i+len < _n && len < MB_MAX_REGS_W && _w[i+len].slave == _w[i].slave 
+			  && _w[i+len].addr == _w[i].addr+len) {
+			len++;
+		}
+		if(len == 1) {
+			rtu.sendWriteRegister(_w[i].slave, _w[i].addr, _w[i].value);
+		}
+		else {
+			uint16_t values[MB_BATCH_SIZE];
+			for(uint8_t k=0; k<len; k++) {
+				values[k] = _w[i+k].value;
+			}
+			rtu.sendWriteRegisters(_w[i].slave, _w[i].addr, values, len);
+		}
+		frames++;
+		if(_w[i].slave != 0 && !rtu.recv_write(_w[i].slave)) 	// broadcast has no response
+			_failed++;
+		i += len;
+	}
+	_n = 0;
+	return frames;
+}
+
+uint8_t CprE_mbWriteBatch::failed() {
+	return _failed;
+}
+
+uint8_t CprE_mbWriteBatch::size() {
+	return _n;
+}
+
+void CprE_mbWriteBatch::clear() {
+	_n = 0;
+}
@@ -0,0 +1,48 @@
+#ifndef CPRE_MB_WRITE_BATCH_H
+#define CPRE_MB_WRITE_BATCH_H
+
+#include <Arduino.h>
+#include "CprE_modbusRTU.h"
+
+#define MB_BATCH_SIZE	32		// max pending register writes
+
+struct mbWrite {
+	uint8_t  slave;
+	uint16_t addr;
+	uint16_t value;
+};
+
+// Collect register writes and send them with as few frames as possible.
+// Writes to adjacent registers of the same slave are coalesced into one FC16
+// frame, a lone register is sent with FC06. A later write to the same
+// register replaces the pending one.
+class CprE_mbWriteBatch {
+	public:
+		bool add(uint8_t SS, uint16_t addr, uint16_t value);
+		
+		// multi-register value in given order, e.g. add<MB_CDAB, float>(1, 100, 23.5)
+		template <mbOrder ORDER, typename T>
+		bool add(uint8_t SS, uint16_t addr, T value) {
+			uint8_t raw[sizeof(T)];
+			mbCodec<ORDER, T>::encode(value, raw);
+			if(_n + sizeof(T)/2 > MB_BATCH_SIZE) 
+				return false;
+			for(uint8_t i=0; i<sizeof(T)/2; i++) {
+				add(SS, addr+i, ((uint16_t)raw[2*i] << 8) | raw[2*i+1]);
+			}
+			return true;
+		}
+		
+		// send all pending writes, return number of frames sent
+		int flush(CprE_modbusRTU &rtu);
+		uint8_t failed();		// frames not confirmed in last flush()
+		uint8_t size();
+		void clear();
+		
+	private:
+		mbWrite _w[MB_BATCH_SIZE];
+		uint8_t _n = 0;
+		uint8_t _failed = 0;
+};
+
+#endif
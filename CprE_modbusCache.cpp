@@ -0,0 +1,105 @@
+#include "CprE_modbusCache.h"
+
+void CprE_modbusCache::begin(CprE_modbusRTU &rtu, mbCachePoint* points, int n, uint8_t max_gap) {
+	_rtu = &rtu;
+	_points = points;
+	_n = n;
+	_gap = max_gap;
+	for(int i=0; i<n; i++) {
+		_points[i].time = 0;
+		_points[i].tried = 0;
+		_points[i].point.error = 0;
+		_points[i].quality = MB_Q_NONE;
+	}
+}
+
+void CprE_modbusCache::onChange(mbChangeCallback cb, void* arg) {
+	_cb = cb;
+	_arg = arg;
+}
+
+bool CprE_modbusCache::due(const mbCachePoint &p, unsigned long now) {
+	if(p.quality == MB_Q_NONE && !p.point.error) 
+		return true;							// never tried
+	// failed points are retried after 1/4 period
+	return now - p.tried >= (p.point.error? p.period/4 : p.period);
+}
+
+int CprE_modbusCache::update() {
+	mbPoint batch[MB_CACHE_BATCH];
+	int16_t index[MB_CACHE_BATCH];
+	int requests = 0;
+	int i = 0;
+	while(i < _n) {
+		// collect due points
+		unsigned long now = millis();
+		int k = 0;
+		for(; i<_n && k<MB_CACHE_BATCH; i++) {
+			if(due(_points[i], now)) {
+				batch[k] = _points[i].point;
+				index[k++] = i;
+			}
+		}
+		if(k == 0) 
+			break;
+		requests += _rtu->readPlan(batch, k, _gap);
+		
+		// store results
+		now = millis();
+		for(int j=0; j<k; j++) {
+			mbCachePoint &p = _points[index[j]];
+			p.point.error = batch[j].error;
+			p.tried = now;
+			if(batch[j].error) {
+				if(p.quality != MB_Q_NONE) 
+					p.quality = MB_Q_BAD;			// keep old value
+				continue;
+			}
+			bool first = p.quality == MB_Q_NONE;
+			p.point.value = batch[j].value;
+			p.time = now;
+			p.quality = MB_Q_GOOD;
+			if(first || fabs(p.point.value - p.reported) > p.deadband) {
+				p.reported = p.point.value;
+				if(_cb) 
+					_cb(index[j], p, _arg);
+			}
+		}
+	}
+	return requests;
+}
+
+int CprE_modbusCache::find(uint8_t SS, uint8_t func, uint16_t addr) {
+	for(int i=0; i<_n; i++) {
+		const mbPoint &p = _points[i].point;
+		if(p.slave == SS && p.func == func && p.addr == addr) 
+			return i;
+	}
+	return -1;
+}
+
+bool CprE_modbusCache::get(uint8_t SS, uint8_t func, uint16_t addr, float &value, unsigned long max_age) {
+	int i = find(SS, func, addr);
+	if(i < 0 || _points[i].quality == MB_Q_NONE) 
+		return false;
+	if(max_age == 0) 
+		max_age = 2*_points[i].period;
+	if(millis() - _points[i].time > max_age) 
+		return false;
+	value = _points[i].point.value;
+	return true;
+}
+
+uint8_t CprE_modbusCache::quality(int index) {
+	if(index < 0 || index >= _n) 
+		return MB_Q_NONE;
+	mbCachePoint &p = _points[index];
+	if(p.quality == MB_Q_GOOD && millis() - p.time > 2*p.period) 
+		return MB_Q_STALE;
+	return p.quality;
+}
+
+void CprE_modbusCache::invalidate(int index) {
+	if(index >= 0 && index < _n) 
+		_points[index].tried = millis() - _points[index].period;
+}
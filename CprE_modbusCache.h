@@ -0,0 +1,57 @@
+#ifndef CPRE_MODBUS_CACHE_H
+#define CPRE_MODBUS_CACHE_H
+
+#include <Arduino.h>
+#include "CprE_modbusRTU.h"
+
+#define MB_CACHE_BATCH	64		// max due points read by one readPlan() call
+
+// quality of a cached value
+enum mbQuality : uint8_t {
+	MB_Q_NONE,		// never read
+	MB_Q_GOOD,		// read within its period
+	MB_Q_STALE,		// not refreshed for more than 2 periods
+	MB_Q_BAD		// last read failed, value is from an older read
+};
+
+struct mbCachePoint {
+	mbPoint point;				// slave, func, addr, type, ... (value = last good value)
+	unsigned long period;		// refresh period (ms)
+	float deadband;				// notify when value moved more than this since last notify
+	unsigned long time;			// millis() of last good read
+	unsigned long tried;		// millis() of last read attempt
+	uint8_t quality;			// mbQuality
+	float reported;				// value at last notify
+};
+
+typedef void (*mbChangeCallback)(int index, const mbCachePoint &p, void* arg);
+
+// Register image of slave devices. Each point is refreshed from the bus only
+// when its own period has passed. Reads of fresh points are served from memory.
+class CprE_modbusCache {
+	public:
+		void begin(CprE_modbusRTU &rtu, mbCachePoint* points, int n, uint8_t max_gap = MB_PLAN_GAP);
+		void onChange(mbChangeCallback cb, void* arg = NULL);
+		
+		// read all due points, call often in loop(), return number of requests sent
+		int update();
+		
+		// a point is (slave, function, address) : holding and input register N differ
+		int find(uint8_t SS, uint8_t func, uint16_t addr);
+		// value from memory, false when unknown or older than <max_age> ms (0 = 2 periods)
+		bool get(uint8_t SS, uint8_t func, uint16_t addr, float &value, unsigned long max_age = 0);
+		uint8_t quality(int index);
+		void invalidate(int index);		// force read in next update()
+		
+	private:
+		CprE_modbusRTU* _rtu;
+		mbCachePoint* _points;
+		int _n = 0;
+		uint8_t _gap;
+		mbChangeCallback _cb = NULL;
+		void* _arg = NULL;
+		
+		bool due(const mbCachePoint &p, unsigned long now);
+};
+
+#endif
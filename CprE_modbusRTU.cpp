@@ -8,6 +8,12 @@ void CprE_modbusRTU::initSerial(HardwareSerial &serial, int dirpin) {
 	_serial = &serial;
 	_dirpin = dirpin;
 	pinMode(dirpin, OUTPUT);
+	_baud = 0;
+	_serial->onReceive([this]() { _rxIdle = true; }, true);	// UART rx-timeout
+}
+
+void CprE_modbusRTU::setTimeout(unsigned long ms) {
+	_timeout = ms;
 }
 
 uint8_t CprE_modbusRTU::getError() {
@@ -30,30 +36,22 @@ String CprE_modbusRTU::errorReport() {
 			return "EXCEPTION RESPONSE";
 		case 6:
 			return "NO DATA FROM THIS PACKET";
+		case 7:
+			return "INVALID REQUEST";
 		default:
 			return "UNKNOWN";
 	}
 }
 
 void CprE_modbusRTU::crc16_update(uint16_t &crc_holder, uint8_t byteIn) {
-	crc_holder ^= byteIn;
-	for (uint8_t i=0; i<8; i++){
-		if(crc_holder & 1) 
-			crc_holder = (crc_holder >> 1) ^ 0xA001;
-		else 
-			crc_holder >>= 1;
-	}
+	crc_holder = CprE_crc16::step(crc_holder, byteIn);
 }
 
-uint16_t CprE_modbusRTU::crc16_gen(uint8_t* packet, int len) {
-	uint16_t crc = 0xFFFF;
-	for(uint8_t i=0; i<len; i++) {
-		crc16_update(crc, packet[i]);
-	}
-	return crc;
+uint16_t CprE_modbusRTU::crc16_gen(const uint8_t* packet, int len) {
+	return CprE_crc16::compute(packet, len);
 }
 
-void CprE_modbusRTU::sendpacket(uint8_t* packet, int length, bool auto_crc) {
+void CprE_modbusRTU::sendpacket(const uint8_t* packet, int length, bool auto_crc) {
 	uint16_t crcA, crcB;
 	if(auto_crc) {
 		uint16_t crc = crc16_gen(packet,length);
@@ -61,44 +59,113 @@ void CprE_modbusRTU::sendpacket(uint8_t* packet, int length, bool auto_crc) {
 		crcB = crc >> 8;
 	}
 	
-	uint32_t br = _serial->baudRate();           	// Get baudrate of _serial
-	uint16_t dTime = round((96000UL / br) + 0.5);	// Silent time (ms) before and after sending frame
+	frameTiming();
+	while(_serial->available() > 0) {
+		_serial->read();						// drop stale bytes of previous frame
+	}
+	_rxIdle = false;
 	
 	digitalWrite(_dirpin,HIGH);
-	delay(dTime);
+	delayMicroseconds(_t35);					// Silent time (t3.5) before sending frame
 	_serial->write(packet,length);
 	if(auto_crc) {
 		_serial->write(crcA);
 		_serial->write(crcB);
 	}
-	delay(dTime);
+	_serial->flush();							// wait until last bit is sent
 	digitalWrite(_dirpin,LOW);
 }
 
+void CprE_modbusRTU::frameTiming() {
+	uint32_t br = _serial->baudRate();			// Get baudrate of _serial
+	_tchar = 11000000UL / br;					// 1 char = 11 bits
+	if(br > 19200) 
+		_t35 = 1750;							// fixed t3.5 above 19200 bps
+	else 
+		_t35 = (_tchar*7) / 2;
+	if(br != _baud) {
+		// the UART flags t3.5 of silence after the last char it received,
+		// its timeout is counted in 10-bit symbols
+		uint32_t sym = 10000000UL / br;
+		_serial->setRxTimeout((_t35 + sym - 1) / sym);
+		_baud = br;
+	}
+}
+
+int16_t CprE_modbusRTU::frameLength(uint8_t SS) {
+	if(indexMax < 2 || buf[0] != SS) 
+		return 0;
+	uint8_t fc = buf[1];
+	if(fc & 0x80) 
+		return 5;								// SS, FC, exception code, CRC
+	if((fc >= 0x01 && fc <= 0x04) || fc == 0x17) 
+		return (indexMax < 3)? 0 : 5+buf[2];	// SS, FC, byte count, data, CRC
+	if(fc == 0x05 || fc == 0x06 || fc == 0x0F || fc == 0x10) 
+		return 8;								// SS, FC, address, value/quantity, CRC
+	return 0;									// unknown length
+}
+
+// software end of frame when no rx-timeout came : t3.5, plus the time of
+// the missing chars (at most one FIFO) that the UART may still hold
+uint32_t CprE_modbusRTU::rxGap(int16_t expect) {
+	int16_t missing = expect - indexMax;
+	if(missing <= 0) 
+		return _t35;
+	if(missing > MB_RX_FIFO) 
+		missing = MB_RX_FIFO;
+	return _t35 + _tchar*missing;
+}
+
 void CprE_modbusRTU::recv(uint8_t SS) {
 	unsigned long prev_t = millis();
 	while(_serial->available() == 0) {
-		if(millis() - prev_t > 3000) {
+		if(millis() - prev_t > _timeout) {
 			m_error = 1;			// TIMEOUT
 			return;
 		}
+		delay(1);
 	}
-	int8_t indexNow;
 	indexMax = 0;
-	indexPacket = -1;
-	indexData = 0;
-	lastIndexData = 0;
-	m_error = 0;
+	_rxcrc.reset();
 	
-	prev_t = millis();
-	while(_serial->available() > 0) {
-		buf[indexMax++] = _serial->read();
-		while(_serial->available() == 0) {
-			if(millis()-prev_t > 500) {
-				break;				// no more data
+	// Frame ends when expected length is reached or after t3.5 of silence.
+	// The silence is seen by the UART rx-timeout, from the arrival of the
+	// last char, so chars still held in its FIFO don't end the frame early.
+	// The software gap is only a fallback when that event is not raised.
+	int16_t expect = 0;
+	unsigned long last_t = micros();
+	while(true) {
+		bool idle = _rxIdle;		// read before available() : set after the chars are in
+		if(_serial->available() > 0) {
+			uint8_t c = _serial->read();
+			if(indexMax < (int16_t)sizeof(buf)) {
+				buf[indexMax++] = c;
+				_rxcrc.update(c);
 			}
+			last_t = micros();
+			if(expect == 0) 
+				expect = frameLength(SS);
+			if(expect && indexMax >= expect) 
+				break;
+		}
+		else if(idle) {
+			break;					// t3.5 of silence on the line
+		}
+		else {
+			if(micros() - last_t > rxGap(expect)) 
+				break;				// no more data
+			delay(1);				// yield : the UART buffers the chars meanwhile
 		}
 	}
+	parse(SS);
+}
+
+void CprE_modbusRTU::parse(uint8_t SS) {
+	int16_t indexNow;
+	indexPacket = -1;
+	indexData = 0;
+	lastIndexData = 0;
+	m_error = 0;
 	
 	// Check read response packet
  	do {
@@ -115,7 +182,8 @@ void CprE_modbusRTU::recv(uint8_t SS) {
 		}
 		indexPacket = indexNow++;
 		uint8_t dataSize;
-		if(buf[indexNow] <= 0x04) {
+		uint8_t fc = buf[indexNow];
+		if(fc <= 0x04 || fc == 0x17) {
 			dataSize = buf[++indexNow];
 			if(indexNow+dataSize+3 != indexMax) {
 				m_error = 3;		// DAMAGED PACKET
@@ -125,7 +193,16 @@ void CprE_modbusRTU::recv(uint8_t SS) {
 			indexNow += dataSize;
 			lastIndexData = indexNow-1;
 		}
-		else if(buf[indexNow] > 0x80) {
+		else if(fc == 0x05 || fc == 0x06 || fc == 0x0F || fc == 0x10) {
+			if(indexNow+7 != indexMax) {
+				m_error = 3;		// DAMAGED PACKET
+				continue;
+			}
+			indexData = ++indexNow;	// echo of address and value/quantity
+			indexNow += 4;
+			lastIndexData = indexNow-1;
+		}
+		else if(fc > 0x80) {
 			m_error = 5;			// EXCEPTION RESPONSE
 			continue;
 		}
@@ -137,14 +214,15 @@ void CprE_modbusRTU::recv(uint8_t SS) {
 			m_error = 3;			// DAMAGED PACKET
 			return;
 		}
-		uint16_t crc = 0xFFFF;
-		for(uint8_t i=indexPacket; i<indexNow; i++) {
-			crc16_update(crc, buf[i]);
+		bool crcOK;
+		if(indexPacket == 0 && indexNow+2 == indexMax) {
+			crcOK = _rxcrc.valid();	// whole buffer is the frame, CRC was updated on arrival
+		}
+		else {
+			uint16_t crc = crc16_gen(buf+indexPacket, indexNow-indexPacket);
+			crcOK = ((crc & 0xFF) == buf[indexNow]) && ((crc >> 8) == buf[indexNow+1]);
 		}
-		uint8_t crcA = crc & 0xFF;
-		uint8_t crcB = crc >> 8;
-		if((crcA != buf[indexNow]) || (crcB != buf[indexNow+1])) {
-			indexPacket = 0;
+		if(!crcOK) {
 			indexData = 0;
 			lastIndexData = 0;
 			m_error = 4;			// CRC INCORRECT
@@ -175,6 +253,59 @@ void CprE_modbusRTU::sendReadInput(uint8_t SS, int start_addr, int reg_len) {
 	sendpacket(packet, 6, true);
 }
 
+void CprE_modbusRTU::sendWriteCoil(uint8_t SS, int addr, bool state) {
+	uint8_t packet[6] = {SS, 0x05, (uint8_t)(addr>>8), (uint8_t)addr, (uint8_t)(state? 0xFF:0x00), 0x00};
+	sendpacket(packet, 6, true);
+}
+
+void CprE_modbusRTU::sendWriteRegister(uint8_t SS, int addr, uint16_t value) {
+	uint8_t packet[6] = {SS, 0x06, (uint8_t)(addr>>8), (uint8_t)addr, (uint8_t)(value>>8), (uint8_t)value};
+	sendpacket(packet, 6, true);
+}
+
+void CprE_modbusRTU::sendWriteCoils(uint8_t SS, int start_addr, const bool* states, int len) {
+	if(len < 1 || len > MB_MAX_COILS_W) 
+		return;
+	uint8_t packet[7+MB_MAX_COILS_W/8+1] = {SS, 0x0F, (uint8_t)(start_addr>>8), (uint8_t)start_addr, 
+											(uint8_t)(len>>8), (uint8_t)len, (uint8_t)((len+7)/8)};
+	for(int i=0; i<len; i++) {
+		if(states[i]) 
+			packet[7+i/8] |= 1 << (i%8);
+	}
+	sendpacket(packet, 7+packet[6], true);
+}
+
+void CprE_modbusRTU::sendWriteRegisters(uint8_t SS, int start_addr, const uint16_t* values, int len) {
+	if(len < 1 || len > MB_MAX_REGS_W) 
+		return;
+	uint8_t packet[7+2*MB_MAX_REGS_W] = {SS, 0x10, (uint8_t)(start_addr>>8), (uint8_t)start_addr, 
+										 (uint8_t)(len>>8), (uint8_t)len, (uint8_t)(2*len)};
+	for(int i=0; i<len; i++) {
+		packet[7+2*i] = values[i] >> 8;
+		packet[8+2*i] = values[i];
+	}
+	sendpacket(packet, 7+2*len, true);
+}
+
+void CprE_modbusRTU::sendReadWriteRegisters(uint8_t SS, int read_addr, int read_len, int write_addr, const uint16_t* values, int write_len) {
+	if(write_len < 1 || write_len > MB_MAX_RW_W || read_len < 1 || read_len > MB_MAX_RW_R) 
+		return;
+	uint8_t packet[11+2*MB_MAX_RW_W] = {SS, 0x17, (uint8_t)(read_addr>>8), (uint8_t)read_addr, 
+										(uint8_t)(read_len>>8), (uint8_t)read_len, 
+										(uint8_t)(write_addr>>8), (uint8_t)write_addr, 
+										(uint8_t)(write_len>>8), (uint8_t)write_len, (uint8_t)(2*write_len)};
+	for(int i=0; i<write_len; i++) {
+		packet[11+2*i] = values[i] >> 8;
+		packet[12+2*i] = values[i];
+	}
+	sendpacket(packet, 11+2*write_len, true);
+}
+
+bool CprE_modbusRTU::recv_write(uint8_t SS) {
+	recv(SS);
+	return !getError();
+}
+
 int8_t CprE_modbusRTU::recv_byte(uint8_t SS) {
 	recv(SS);
 	if(!getError()) {
@@ -220,20 +351,229 @@ String CprE_modbusRTU::recv_string(uint8_t SS) {
 	recv(SS);
 	if(!getError()) {
 		String str = "";
-		for(uint8_t i=indexData; i<=lastIndexData; i++) {
+		str.reserve(lastIndexData-indexData+1);
+		for(int16_t i=indexData; i<=lastIndexData; i++) {
 			str += char(buf[i]);
 		}
+		return str;
 	}
 	else 
 		return "";
 }
- 
- 
- 
- 
- 
- 
- 
- 
- 
- 
+
+CprE_mbView CprE_modbusRTU::response() {
+	if(m_error) 
+		return CprE_mbView();
+	return CprE_mbView(buf+indexData, lastIndexData-indexData+1);
+}
+
+uint8_t CprE_modbusRTU::regCount(uint8_t type) {
+	switch(type) {
+		case MB_INT16:
+		case MB_UINT16:
+			return 1;
+		case MB_INT64:
+		case MB_DOUBLE:
+			return 4;
+		default:
+			return 2;
+	}
+}
+
+float CprE_modbusRTU::decodePoint(const CprE_mbView &v, uint8_t reg, const mbPoint &p) {
+	mbOrder order = (mbOrder)p.order;
+	switch(p.type) {
+		case MB_INT16:
+			return v.i16(reg);
+		case MB_UINT16:
+			return v.u16(reg);
+		case MB_INT32:
+			return v.i32(reg, order);
+		case MB_UINT32:
+			return v.u32(reg, order);
+		case MB_INT64:
+			return v.i64(reg, order);
+		case MB_DOUBLE:
+			return v.f64(reg, order);
+		default:
+			return v.f32(reg, order);
+	}
+}
+
+int CprE_modbusRTU::readPlan(mbPoint* points, int n, uint8_t max_gap) {
+	const uint8_t PENDING = 0xFF;
+	int requests = 0;
+	for(int i=0; i<n; i++) {
+		points[i].error = (points[i].func == 0x03 || points[i].func == 0x04)? PENDING:7;
+	}
+	
+	for(int i=0; i<n; i++) {
+		if(points[i].error != PENDING) 
+			continue;
+		
+		// grow block [lo,hi) around the first pending point
+		uint8_t SS = points[i].slave;
+		uint8_t fc = points[i].func;
+		uint16_t lo = points[i].addr;
+		uint32_t hi = (uint32_t)lo + regCount(points[i].type);
+		bool grown = true;
+		while(grown) {
+			grown = false;
+			for(int j=i+1; j<n; j++) {
+				mbPoint &p = points[j];
+				if(p.error != PENDING || p.slave != SS || p.func != fc) 
+					continue;
+				uint32_t a = p.addr;
+				uint32_t b = a + regCount(p.type);
+				if(a >= lo && b <= hi) 
+					continue;				// already inside
+				if(a > hi + max_gap || b + max_gap < lo) 
+					continue;				// too far away
+				uint32_t nlo = (a < lo)? a:lo;
+				uint32_t nhi = (b > hi)? b:hi;
+				if(nhi - nlo > MB_MAX_REGS) 
+					continue;
+				lo = nlo;
+				hi = nhi;
+				grown = true;
+			}
+		}
+		
+		// one request for the whole block
+		uint16_t len = hi - lo;
+		if(fc == 0x03) 
+			sendReadHolding(SS, lo, len);
+		else 
+			sendReadInput(SS, lo, len);
+		recv(SS);
+		requests++;
+		uint8_t err = m_error;
+		if(!err && lastIndexData-indexData+1 != 2*len) 
+			err = 3;						// DAMAGED PACKET
+		
+		// scatter values back to points inside this block
+		CprE_mbView v = response();
+		for(int j=i; j<n; j++) {
+			mbPoint &p = points[j];
+			if(p.error != PENDING || p.slave != SS || p.func != fc) 
+				continue;
+			if(p.addr < lo || p.addr + regCount(p.type) > hi) 
+				continue;
+			p.error = err;
+			if(!err) 
+				p.value = decodePoint(v, p.addr-lo, p);
+		}
+	}
+	return requests;
+}
+
+bool CprE_modbusRTU::enqueue(uint8_t* packet, int length, mbCallback cb, void* arg) {
+	if(_qcount >= MB_QUEUE_SIZE || length < 2 || length+2 > MB_FRAME_MAX) 
+		return false;
+	mbRequest &req = _queue[(_qhead+_qcount) % MB_QUEUE_SIZE];
+	memcpy(req.frame, packet, length);
+	uint16_t crc = crc16_gen(packet, length);
+	req.frame[length] = crc & 0xFF;
+	req.frame[length+1] = crc >> 8;
+	req.length = length+2;
+	req.cb = cb;
+	req.arg = arg;
+	_qcount++;
+	return true;
+}
+
+bool CprE_modbusRTU::enqueueRead(uint8_t SS, uint8_t func, int start_addr, int reg_len, mbCallback cb, void* arg) {
+	uint8_t packet[6] = {SS, func, (uint8_t)(start_addr>>8), (uint8_t)start_addr, (uint8_t)(reg_len>>8), (uint8_t)reg_len};
+	return enqueue(packet, 6, cb, arg);
+}
+
+bool CprE_modbusRTU::busy() {
+	return _qcount > 0;
+}
+
+uint8_t CprE_modbusRTU::pending() {
+	return _qcount;
+}
+
+void CprE_modbusRTU::poll() {
+	if(_qcount == 0) 
+		return;
+	mbRequest &req = _queue[_qhead];
+	uint8_t SS = req.frame[0];
+	
+	switch(_state) {
+		case MB_IDLE:
+			frameTiming();
+			while(_serial->available() > 0) {
+				_serial->read();				// drop stale bytes of previous frame
+			}
+			_rxIdle = false;
+			digitalWrite(_dirpin,HIGH);
+			_stamp = micros();
+			_state = MB_TX;
+			break;
+		
+		case MB_TX:
+			if(micros() - _stamp < _t35) 
+				break;							// silent time before frame
+			_serial->write(req.frame, req.length);
+			_stamp = micros();
+			_state = MB_TX_WAIT;
+			break;
+		
+		case MB_TX_WAIT:
+			if(micros() - _stamp < (req.length+1)*_tchar) 
+				break;							// frame is still being sent
+			digitalWrite(_dirpin,LOW);
+			indexMax = 0;
+			_rxcrc.reset();
+			_expect = 0;
+			_rxstart = millis();
+			_state = MB_RX;
+			break;
+		
+		case MB_RX: {
+			bool idle = _rxIdle;
+			while(_serial->available() > 0) {
+				uint8_t c = _serial->read();
+				if(indexMax < (int16_t)sizeof(buf)) {
+					buf[indexMax++] = c;
+					_rxcrc.update(c);
+				}
+				_stamp = micros();
+				if(_expect == 0) 
+					_expect = frameLength(SS);
+			}
+			if(indexMax == 0) {
+				if(millis() - _rxstart > _timeout) {
+					m_error = 1;				// TIMEOUT
+					finish();
+				}
+				break;
+			}
+			if(_expect && indexMax >= _expect) {
+				parse(SS);
+				finish();
+			}
+			else if(idle || micros() - _stamp > rxGap(_expect)) {
+				parse(SS);						// no more data
+				finish();
+			}
+			break;
+		}
+	}
+}
+
+void CprE_modbusRTU::finish() {
+	mbRequest &req = _queue[_qhead];
+	uint8_t SS = req.frame[0];
+	mbCallback cb = req.cb;
+	void* arg = req.arg;
+	_qhead = (_qhead+1) % MB_QUEUE_SIZE;		// free slot before callback, it may enqueue again
+	_qcount--;
+	_state = MB_IDLE;
+	if(cb) {
+		uint8_t len = m_error? 0 : lastIndexData-indexData+1;
+		cb(SS, m_error, buf+indexData, len, arg);
+	}
+}
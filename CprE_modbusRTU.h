@@ -3,19 +3,74 @@
 
 #include <Arduino.h>
 #include <Stream.h>
+#include "CprE_crc16.h"
+#include "CprE_mbView.h"
+
+#define MB_MAX_REGS		125		// max registers of one FC03/FC04 request
+#define MB_MAX_REGS_W	123		// max registers of one FC16 request
+#define MB_MAX_COILS_W	1968	// max coils of one FC15 request
+#define MB_MAX_RW_R		125		// max registers read by one FC23 request
+#define MB_MAX_RW_W		121		// max registers written by one FC23 request
+#define MB_PLAN_GAP		8		// default unused registers allowed between merged points
+#define MB_TIMEOUT		3000	// default response timeout (ms)
+#define MB_RX_FIFO		120		// chars held by UART FIFO before driver hands them over (fallback gap)
+#define MB_QUEUE_SIZE	8		// max requests waiting in async master queue
+#define MB_FRAME_MAX	32		// max request length (with CRC) kept in queue
+
+// type of value stored at a register address
+enum mbType : uint8_t {
+	MB_INT16,
+	MB_UINT16,
+	MB_INT32,
+	MB_UINT32,
+	MB_FLOAT,
+	MB_INT64,
+	MB_DOUBLE
+};
+
+// one point of a read plan : (slave, function, address, type) -> value
+struct mbPoint {
+	uint8_t  slave;		// slave address
+	uint8_t  func;		// 0x03 (holding) or 0x04 (input)
+	uint16_t addr;		// register address
+	uint8_t  type;		// mbType
+	uint8_t  error;		// error of last read (same code as getError())
+	float    value;		// decoded value of last read
+	uint8_t  order;		// mbOrder of 32/64-bit types (default MB_ABCD)
+};
+
+// called when an async request is done
+// <data>,<len> : data bytes of response (valid only inside callback)
+typedef void (*mbCallback)(uint8_t SS, uint8_t error, const uint8_t* data, uint8_t len, void* arg);
+
+// state of async master
+enum mbState : uint8_t {
+	MB_IDLE,		// waiting for request in queue
+	MB_TX,			// direction pin set, waiting t3.5 before frame
+	MB_TX_WAIT,		// frame written, waiting until it is on the line
+	MB_RX			// waiting for response
+};
+
+struct mbRequest {
+	uint8_t frame[MB_FRAME_MAX];
+	uint8_t length;
+	mbCallback cb;
+	void* arg;
+};
 
 class CprE_modbusRTU {
 	public:
-		uint8_t buf[128];
+		uint8_t buf[256];
 		int buf_length();
 		
 		void initSerial(HardwareSerial &serial, int dirpin);
+		void setTimeout(unsigned long ms);	// time to wait for first byte of response
 		uint8_t getError();
 		String errorReport();
 		void crc16_update(uint16_t &crc_holder, uint8_t byteIn);
-		uint16_t crc16_gen(uint8_t* packet, int len);
+		uint16_t crc16_gen(const uint8_t* packet, int len);
 		
-		void sendpacket(uint8_t* packet, int length, bool auto_crc = false);
+		void sendpacket(const uint8_t* packet, int length, bool auto_crc = false);
 		void recv(uint8_t SS);			// read and store in <buf>
 		
 		void sendReadCoil(uint8_t SS, int start_addr, int reg_len);
@@ -23,19 +78,66 @@ class CprE_modbusRTU {
 		void sendReadHolding(uint8_t SS, int start_addr, int reg_len);
 		void sendReadInput(uint8_t SS, int start_addr, int reg_len);
 		
+		void sendWriteCoil(uint8_t SS, int addr, bool state);							// FC05
+		void sendWriteRegister(uint8_t SS, int addr, uint16_t value);					// FC06
+		void sendWriteCoils(uint8_t SS, int start_addr, const bool* states, int len);		// FC15
+		void sendWriteRegisters(uint8_t SS, int start_addr, const uint16_t* values, int len);	// FC16
+		void sendReadWriteRegisters(uint8_t SS, int read_addr, int read_len, 
+									int write_addr, const uint16_t* values, int write_len);	// FC23, read data by response()
+		bool recv_write(uint8_t SS);	// return true when write is confirmed by slave
+		
 		int8_t recv_byte(uint8_t SS);	// return only highest-order data
 		long   recv_int(uint8_t SS);	// return all data in [long] format
 		float  recv_float(uint8_t SS);	// return 4 bytes data in [float] format
 		String recv_string(uint8_t SS);	// return all data in [String] format
+		CprE_mbView response();			// typed view over data of last response (empty on error)
+		
+		// read all <points> with as few FC03/FC04 requests as possible
+		// points of the same slave/function which are at most <max_gap> registers apart
+		// are merged into one request, return number of requests sent
+		int readPlan(mbPoint* points, int n, uint8_t max_gap = MB_PLAN_GAP);
+		static uint8_t regCount(uint8_t type);
+		
+		// Async master : requests are queued and handled by poll() without blocking.
+		// Call poll() often in loop(). Don't use blocking functions while busy().
+		bool enqueue(uint8_t* packet, int length, mbCallback cb, void* arg = NULL);	// CRC is appended
+		bool enqueueRead(uint8_t SS, uint8_t func, int start_addr, int reg_len, mbCallback cb, void* arg = NULL);
+		void poll();
+		bool busy();
+		uint8_t pending();
 		
 	private:
+		friend class CprE_modbusSlave;	// shares buffer, CRC and line timing
+		
 		HardwareSerial* _serial;
 		int _dirpin;
-		int8_t indexMax = 0;
-		int8_t indexPacket = 0;
-		int8_t indexData = 0;
-		int8_t lastIndexData = 0;
+		int16_t indexMax = 0;
+		int16_t indexPacket = 0;
+		int16_t indexData = 0;
+		int16_t lastIndexData = 0;
 		uint8_t m_error = 0;
+		unsigned long _timeout = MB_TIMEOUT;
+		uint32_t _tchar = 0;		// time of 1 char (us)
+		uint32_t _t35 = 0;			// inter-frame silent time t3.5 (us)
+		uint32_t _baud = 0;			// baudrate the UART rx-timeout was set for
+		volatile bool _rxIdle = false;	// UART rx-timeout since the request was sent
+		
+		void frameTiming();
+		uint32_t rxGap(int16_t expect);
+		int16_t frameLength(uint8_t SS);
+		void parse(uint8_t SS);
+		
+		mbRequest _queue[MB_QUEUE_SIZE];
+		uint8_t _qhead = 0;
+		uint8_t _qcount = 0;
+		mbState _state = MB_IDLE;
+		unsigned long _stamp = 0;	// time of last state change or last byte (us)
+		unsigned long _rxstart = 0;	// time when response is awaited (ms)
+		int16_t _expect = 0;
+		CprE_crc16 _rxcrc;			// running CRC of received bytes
+		void finish();
+		
+		static float decodePoint(const CprE_mbView &v, uint8_t reg, const mbPoint &p);
 };
 
 #endif
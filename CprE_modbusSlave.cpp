@@ -0,0 +1,270 @@
+#include "CprE_modbusSlave.h"
+
+void CprE_modbusSlave::begin(HardwareSerial &serial, int dirpin, uint8_t id) {
+	_rtu.initSerial(serial, dirpin);
+	digitalWrite(dirpin, LOW);
+	_rtu.frameTiming();							// rx-timeout = t3.5
+	_rtu.indexMax = 0;
+	_ready = false;
+	_id = id;
+	serial.onReceive([this]() { receive(); }, true);	// in place of the master one
+}
+
+void CprE_modbusSlave::setCoils(uint8_t* bits, uint16_t start, uint16_t count) {
+	_coils = {bits, start, count};
+}
+
+void CprE_modbusSlave::setDiscrete(uint8_t* bits, uint16_t start, uint16_t count) {
+	_discrete = {bits, start, count};
+}
+
+void CprE_modbusSlave::setHolding(uint16_t* regs, uint16_t start, uint16_t count) {
+	_holding = {regs, start, count};
+}
+
+void CprE_modbusSlave::setInput(uint16_t* regs, uint16_t start, uint16_t count) {
+	_input = {regs, start, count};
+}
+
+void CprE_modbusSlave::onWrite(mbWriteCallback cb, void* arg) {
+	_cb = cb;
+	_arg = arg;
+}
+
+uint32_t CprE_modbusSlave::requests() {
+	return _requests;
+}
+
+uint32_t CprE_modbusSlave::errors() {
+	return _errors;
+}
+
+// A frame of known length that ends on a valid CRC inside the data : a
+// request, or the response of another slave on a multidrop bus. Else all
+// the data is one frame and its CRC decides.
+int16_t CprE_modbusSlave::frameLength(const uint8_t* p, int16_t n) {
+	int16_t len[2] = {0, 0};
+	if(n >= 3) {
+		uint8_t fc = p[1];
+		if(fc & 0x80) {
+			len[0] = 5;							// exception response
+		}
+		else if(fc >= 0x01 && fc <= 0x06) {
+			len[0] = 8;							// SS, FC, address, quantity/value, CRC
+			if(fc <= 0x04) 
+				len[1] = 5+p[2];				// read response
+		}
+		else if(fc == 0x0F || fc == 0x10) {
+			len[0] = 8;							// write response
+			if(n >= 7) 
+				len[1] = 9+p[6];
+		}
+	}
+	for(uint8_t i=0; i<2; i++) {
+		if(len[i] > 0 && len[i] < n && CprE_crc16::compute(p, len[i]) == 0) 
+			return len[i];
+	}
+	return n;
+}
+
+// UART event task, after t3.5 of silence on the line. The chars read here
+// are whole frames, more than one when this task ran late. Requests for
+// this slave go to task() one at a time, a frame that comes while the
+// previous one is still in process() is dropped.
+void CprE_modbusSlave::receive() {
+	int16_t n = 0;
+	while(_rtu._serial->available() > 0) {
+		uint8_t c = _rtu._serial->read();
+		if(n < (int16_t)sizeof(_rx)) 
+			_rx[n++] = c;
+	}
+	for(int16_t pos=0; pos<n; ) {
+		const uint8_t* f = _rx + pos;
+		int16_t len = frameLength(f, n - pos);
+		pos += len;
+		if(f[0] != _id && f[0] != 0) 
+			continue;							// request for another slave, or its response
+		int16_t need = 4;
+		if(len >= 2 && f[1] >= 0x01 && f[1] <= 0x06) 
+			need = 8;
+		else if(len >= 2 && (f[1] == 0x0F || f[1] == 0x10)) 
+			need = 9;
+		if(len < need || CprE_crc16::compute(f, len) != 0 || _ready) {
+			_errors++;
+			continue;
+		}
+		memcpy(_rtu.buf, f, len);
+		_rtu.indexMax = len;
+		_ready = true;
+	}
+}
+
+// like sendpacket() without draining the port : only receive() reads it
+void CprE_modbusSlave::reply(uint8_t n) {
+	uint16_t crc = CprE_crc16::compute(_resp, n);
+	_resp[n] = crc & 0xFF;
+	_resp[n+1] = crc >> 8;
+	digitalWrite(_rtu._dirpin, HIGH);
+	delayMicroseconds(_rtu._t35);				// Silent time (t3.5) before sending frame
+	_rtu._serial->write(_resp, n+2);
+	_rtu._serial->flush();						// wait until last bit is sent
+	digitalWrite(_rtu._dirpin, LOW);
+}
+
+void CprE_modbusSlave::task() {
+	if(!_ready) 
+		return;
+	process();
+	_ready = false;
+}
+
+bool CprE_modbusSlave::inside(const mbTable &t, uint16_t addr, uint16_t qty) {
+	return t.data != NULL && addr >= t.start && (uint32_t)addr - t.start + qty <= t.count;
+}
+
+uint8_t CprE_modbusSlave::exception(uint8_t code) {
+	_resp[1] |= 0x80;
+	_resp[2] = code;
+	return 3;
+}
+
+uint8_t CprE_modbusSlave::readBits(const mbTable &t, uint16_t addr, uint16_t qty) {
+	if(qty < 1 || qty > 2000) 
+		return exception(0x03);					// ILLEGAL DATA VALUE
+	if(!inside(t, addr, qty)) 
+		return exception(0x02);					// ILLEGAL DATA ADDRESS
+	const uint8_t* bits = (const uint8_t*)t.data;
+	uint8_t n = (qty+7)/8;
+	_resp[2] = n;
+	memset(_resp+3, 0, n);
+	uint16_t first = addr - t.start;
+	for(uint16_t i=0; i<qty; i++) {
+		uint16_t b = first + i;
+		if(bits[b/8] & (1 << (b%8))) 
+			_resp[3+i/8] |= 1 << (i%8);
+	}
+	return 3+n;
+}
+
+uint8_t CprE_modbusSlave::readRegs(const mbTable &t, uint16_t addr, uint16_t qty) {
+	if(qty < 1 || qty > MB_MAX_REGS) 
+		return exception(0x03);
+	if(!inside(t, addr, qty)) 
+		return exception(0x02);
+	const uint16_t* regs = (const uint16_t*)t.data + (addr - t.start);
+	_resp[2] = 2*qty;
+	for(uint16_t i=0; i<qty; i++) {
+		_resp[3+2*i] = regs[i] >> 8;
+		_resp[4+2*i] = regs[i];
+	}
+	return 3+2*qty;
+}
+
+void CprE_modbusSlave::process() {
+	uint8_t* buf = _rtu.buf;
+	int16_t len = _rtu.indexMax;				// checked by receive()
+	
+	uint8_t fc = buf[1];
+	uint16_t addr = ((uint16_t)buf[2] << 8) | buf[3];
+	uint16_t qty = ((uint16_t)buf[4] << 8) | buf[5];
+	_resp[0] = _id;
+	_resp[1] = fc;
+	uint8_t n;
+	bool written = false;
+	
+	switch(fc) {
+		case 0x01:
+			n = readBits(_coils, addr, qty);
+			break;
+		case 0x02:
+			n = readBits(_discrete, addr, qty);
+			break;
+		case 0x03:
+			n = readRegs(_holding, addr, qty);
+			break;
+		case 0x04:
+			n = readRegs(_input, addr, qty);
+			break;
+		case 0x05:
+			if(qty != 0xFF00 && qty != 0x0000) {
+				n = exception(0x03);
+			}
+			else if(!inside(_coils, addr, 1)) {
+				n = exception(0x02);
+			}
+			else {
+				uint8_t* bits = (uint8_t*)_coils.data;
+				uint16_t b = addr - _coils.start;
+				if(qty) 
+					bits[b/8] |= 1 << (b%8);
+				else 
+					bits[b/8] &= ~(1 << (b%8));
+				memcpy(_resp+2, buf+2, 4);		// echo
+				n = 6;
+				qty = 1;
+				written = true;
+			}
+			break;
+		case 0x06:
+			if(!inside(_holding, addr, 1)) {
+				n = exception(0x02);
+			}
+			else {
+				((uint16_t*)_holding.data)[addr - _holding.start] = qty;
+				memcpy(_resp+2, buf+2, 4);
+				n = 6;
+				qty = 1;
+				written = true;
+			}
+			break;
+		case 0x0F:
+			if(qty < 1 || qty > MB_MAX_COILS_W || buf[6] != (qty+7)/8 || len != 9+buf[6]) {
+				n = exception(0x03);
+			}
+			else if(!inside(_coils, addr, qty)) {
+				n = exception(0x02);
+			}
+			else {
+				uint8_t* bits = (uint8_t*)_coils.data;
+				uint16_t first = addr - _coils.start;
+				for(uint16_t i=0; i<qty; i++) {
+					uint16_t b = first + i;
+					if(buf[7+i/8] & (1 << (i%8))) 
+						bits[b/8] |= 1 << (b%8);
+					else 
+						bits[b/8] &= ~(1 << (b%8));
+				}
+				memcpy(_resp+2, buf+2, 4);
+				n = 6;
+				written = true;
+			}
+			break;
+		case 0x10:
+			if(qty < 1 || qty > MB_MAX_REGS_W || buf[6] != 2*qty || len != 9+buf[6]) {
+				n = exception(0x03);
+			}
+			else if(!inside(_holding, addr, qty)) {
+				n = exception(0x02);
+			}
+			else {
+				uint16_t* regs = (uint16_t*)_holding.data + (addr - _holding.start);
+				for(uint16_t i=0; i<qty; i++) {
+					regs[i] = ((uint16_t)buf[7+2*i] << 8) | buf[8+2*i];
+				}
+				memcpy(_resp+2, buf+2, 4);
+				n = 6;
+				written = true;
+			}
+			break;
+		default:
+			n = exception(0x01);				// ILLEGAL FUNCTION
+			break;
+	}
+	
+	if(buf[0] != 0) {							// no response to broadcast
+		reply(n);
+		_requests++;
+	}
+	if(written && _cb) 
+		_cb(fc, addr, qty, _arg);
+}
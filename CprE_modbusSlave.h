@@ -0,0 +1,60 @@
+#ifndef CPRE_MODBUS_SLAVE_H
+#define CPRE_MODBUS_SLAVE_H
+
+#include <Arduino.h>
+#include "CprE_modbusRTU.h"
+
+// called after a master wrote to the map (FC05/06/15/16)
+typedef void (*mbWriteCallback)(uint8_t func, uint16_t addr, uint16_t count, void* arg);
+
+// one table of the register map, address <start> is item 0
+struct mbTable {
+	void* data;			// uint16_t[] for registers, packed bits (LSB first) for coils
+	uint16_t start;
+	uint16_t count;
+};
+
+// Modbus RTU slave serving a memory-resident register map.
+// Tables are flat arrays owned by the sketch, address lookup is (addr - start).
+// Frames end on t3.5 of silence seen by the UART rx-timeout, so the gap is
+// measured from the arrival of the chars, not from when loop() reads them.
+// task() is non-blocking, call it often in loop(). No heap is used.
+class CprE_modbusSlave {
+	public:
+		void begin(HardwareSerial &serial, int dirpin, uint8_t id);
+		void setCoils(uint8_t* bits, uint16_t start, uint16_t count);			// FC01, FC05, FC15
+		void setDiscrete(uint8_t* bits, uint16_t start, uint16_t count);		// FC02
+		void setHolding(uint16_t* regs, uint16_t start, uint16_t count);		// FC03, FC06, FC16
+		void setInput(uint16_t* regs, uint16_t start, uint16_t count);			// FC04
+		void onWrite(mbWriteCallback cb, void* arg = NULL);
+		
+		void task();
+		uint32_t requests();		// requests answered
+		uint32_t errors();			// frames dropped (CRC, length)
+		
+	private:
+		CprE_modbusRTU _rtu;		// framing, CRC and line timing
+		uint8_t _id;
+		mbTable _coils = {NULL, 0, 0};
+		mbTable _discrete = {NULL, 0, 0};
+		mbTable _holding = {NULL, 0, 0};
+		mbTable _input = {NULL, 0, 0};
+		mbWriteCallback _cb = NULL;
+		void* _arg = NULL;
+		uint8_t _resp[256];
+		uint8_t _rx[256];			// chars of the UART event task
+		volatile bool _ready = false;	// request in _rtu.buf for task()
+		uint32_t _requests = 0;
+		uint32_t _errors = 0;
+		
+		void receive();
+		void process();
+		void reply(uint8_t n);
+		uint8_t readBits(const mbTable &t, uint16_t addr, uint16_t qty);
+		uint8_t readRegs(const mbTable &t, uint16_t addr, uint16_t qty);
+		uint8_t exception(uint8_t code);
+		static bool inside(const mbTable &t, uint16_t addr, uint16_t qty);
+		static int16_t frameLength(const uint8_t* p, int16_t n);
+};
+
+#endif
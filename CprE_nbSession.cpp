@@ -0,0 +1,101 @@
+#include "CprE_nbSession.h"
+
+bool CprE_nbSession::begin(CprE_NB_bc95 &modem) {
+	_modem = &modem;
+	// first command may only wake the modem from PSM
+	if(_modem->command("AT", NULL, 1000) != AT_OK && _modem->command("AT", NULL, 1000) != AT_OK) {
+		if(!_modem->initModem()) 
+			return false;
+	}
+	return ensureAttached();
+}
+
+bool CprE_nbSession::ensureAttached(unsigned long timeout) {
+	if(_modem->attached()) 
+		return true;
+	_attaches++;
+	_modem->command("AT+CFUN=1", NULL, 10000);
+	_modem->command("AT+CGATT=1", NULL, 1000);
+	unsigned long start_t = millis();
+	do {
+		delay(500);
+		if(_modem->attached()) 
+			return true;
+	} while(millis() - start_t < timeout);
+	return false;
+}
+
+// GPRS timer 3 (T3412) and timer 2 (T3324) : 3 unit bits + 5 value bits
+void CprE_nbSession::timerBits(uint32_t seconds, bool active, char out[9]) {
+	static const uint32_t tauUnit[] = {2, 30, 60, 600, 3600, 36000, 1152000};
+	static const uint8_t tauCode[] = {3, 4, 5, 0, 1, 2, 6};
+	static const uint32_t actUnit[] = {2, 60, 360};
+	static const uint8_t actCode[] = {0, 1, 2};
+	const uint32_t* unit = active ? actUnit : tauUnit;
+	const uint8_t* code = active ? actCode : tauCode;
+	uint8_t n = active ? 3 : 7;
+	uint8_t bits = 0x1F | (code[n-1] << 5);		// longest value if nothing fits
+	for(uint8_t i=0; i<n; i++) {
+		uint32_t v = (seconds + unit[i] - 1) / unit[i];
+		if(v <= 31) {
+			bits = (code[i] << 5) | v;
+			break;
+		}
+	}
+	for(uint8_t i=0; i<8; i++) 
+		out[i] = (bits & (0x80 >> i)) ? '1' : '0';
+	out[8] = '\0';
+}
+
+bool CprE_nbSession::setPSM(uint32_t tau, uint32_t active) {
+	if(tau == 0) 
+		return _modem->command("AT+CPSMS=0", NULL, 1000) == AT_OK;
+	char t3412[9], t3324[9], cmd[40];
+	timerBits(tau, false, t3412);
+	timerBits(active, true, t3324);
+	snprintf(cmd, sizeof(cmd), "AT+CPSMS=1,,,\"%s\",\"%s\"", t3412, t3324);
+	return _modem->command(cmd, NULL, 1000) == AT_OK;
+}
+
+bool CprE_nbSession::setEDRX(uint8_t cycle) {
+	if(cycle == NB_EDRX_OFF) 
+		return _modem->command("AT+CEDRXS=0,5", NULL, 1000) == AT_OK;
+	char cmd[24];
+	// access technology 5 = NB-S1
+	snprintf(cmd, sizeof(cmd), "AT+CEDRXS=1,5,\"%c%c%c%c\"", 
+		cycle & 8 ? '1':'0', cycle & 4 ? '1':'0', cycle & 2 ? '1':'0', cycle & 1 ? '1':'0');
+	return _modem->command(cmd, NULL, 1000) == AT_OK;
+}
+
+bool CprE_nbSession::plan(uint32_t period, uint32_t active) {
+	// TAU longer than the period : every uplink restarts it, no extra wake-up
+	// and a missed cycle does not lose the registration
+	if(!setPSM(2 * period, active)) 
+		return false;
+	return setEDRX(NB_EDRX_OFF);
+}
+
+bool CprE_nbSession::send(const char* ip, const char* port, const uint8_t* data, size_t len, bool last, bool reply) {
+	uint16_t flags = !last ? MODEM_RAI_NONE : reply ? MODEM_RAI_REPLY : MODEM_RAI_LAST;
+	if(_modem->sendUDP(ip, port, data, len, flags)) 
+		return true;
+	if(!ensureAttached()) 
+		return false;
+	return _modem->sendUDP(ip, port, data, len, flags);
+}
+
+uint32_t CprE_nbSession::scheduleWake(CprE_DS3231 &rtc, uint32_t period) {
+	uint32_t t = rtc.now().unixtime();
+	uint32_t next = (t / period + 1) * period;
+	DateTime w(next);
+	rtc.hold();
+	rtc.clearFlag();
+	rtc.setAlarm1(w.hour(), w.minute(), w.second(), w.day(), false, 'M');
+	rtc.enableAlarm(1);
+	rtc.commit();
+	return next;
+}
+
+uint16_t CprE_nbSession::attaches() {
+	return _attaches;
+}
@@ -0,0 +1,41 @@
+#ifndef CPRE_NB_SESSION_H
+#define CPRE_NB_SESSION_H
+
+#include <Arduino.h>
+#include "CprE_NB_bc95.h"
+#include "CprE_DS3231.h"
+
+#define NB_EDRX_OFF	0xFF
+
+// Keeps the BC95 attached across wake cycles instead of AT+NRB on every
+// boot. The modem sleeps in PSM between uplinks and keeps its network
+// context, so a wake-up costs one uplink instead of a full attach. The
+// ESP32 wake-up comes from DS3231 Alarm1, aligned to the same period.
+class CprE_nbSession {
+	public:
+		// reuse the attach of the running modem, full init only if it does not answer
+		bool begin(CprE_NB_bc95 &modem);
+		bool ensureAttached(unsigned long timeout = MODEM_ATTACH_WAIT);
+		
+		// PSM timers in seconds (T3412 periodic TAU, T3324 active time), tau 0 = PSM off
+		bool setPSM(uint32_t tau, uint32_t active);
+		bool setEDRX(uint8_t cycle);		// 3GPP cycle code 0-15, NB_EDRX_OFF = disable
+		// PSM for an uplink every period seconds
+		bool plan(uint32_t period, uint32_t active = 10);
+		
+		// send, reattach and retry once on failure. last : release radio after it
+		bool send(const char* ip, const char* port, const uint8_t* data, size_t len, bool last = true, bool reply = false);
+		
+		// Alarm1 at the next multiple of period (unix time), returns wake time
+		uint32_t scheduleWake(CprE_DS3231 &rtc, uint32_t period);
+		
+		uint16_t attaches();		// real attach procedures since begin()
+		
+		static void timerBits(uint32_t seconds, bool active, char out[9]);
+		
+	private:
+		CprE_NB_bc95* _modem;
+		uint16_t _attaches = 0;
+};
+
+#endif
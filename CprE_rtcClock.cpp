@@ -0,0 +1,241 @@
+#include "CprE_rtcClock.h"
+
+volatile int64_t CprE_rtcClock::_edgeUs = 0;
+volatile uint32_t CprE_rtcClock::_edges = 0;
+portMUX_TYPE CprE_rtcClock::_edgeMux = portMUX_INITIALIZER_UNLOCKED;
+
+uint8_t CprE_rtcClock::readSeconds() {
+	return _rtc->readAddr(0) & 0x7F;
+}
+
+// full read right after a seconds rollover seen at us
+void CprE_rtcClock::anchor(int64_t us) {
+	move(_rtc->now().unixtime(), us);
+	_lastSync = us;
+}
+
+// the jump against the running clock goes into the slew so time stays
+// continuous, a jump over CLOCK_STEP (DS3231 set elsewhere) is taken
+void CprE_rtcClock::move(uint32_t sec, int64_t us) {
+	int64_t from = (int64_t)_anchorSec * 1000000 + (us - _anchorUs) + offsetAt(us) - (int64_t)sec * 1000000;
+	if(_anchored && from - _slewTo <= CLOCK_STEP && _slewTo - from <= CLOCK_STEP) {
+		_slewFrom = from;
+		_slewStart = us;
+	}
+	else 
+		_slewFrom = _slewTo = 0;
+	_anchorSec = sec;
+	_anchorUs = us;
+	_anchored = true;
+}
+
+bool CprE_rtcClock::begin(CprE_DS3231 &rtc, uint32_t resync) {
+	_rtc = &rtc;
+	_resync = resync;
+	_anchored = false;
+	// wait for the next rollover, at most 1 s, once
+	uint8_t s = readSeconds();
+	int64_t start = esp_timer_get_time();
+	while(esp_timer_get_time() - start < 1100000) {
+		if(readSeconds() != s) {
+			anchor(esp_timer_get_time());
+			return true;
+		}
+		delayMicroseconds(500);
+	}
+	anchor(esp_timer_get_time());		// oscillator stopped ?
+	return false;
+}
+
+void IRAM_ATTR CprE_rtcClock::onEdge() {
+	portENTER_CRITICAL_ISR(&_edgeMux);
+	_edgeUs = esp_timer_get_time();
+	_edges++;
+	portEXIT_CRITICAL_ISR(&_edgeMux);
+}
+
+void CprE_rtcClock::attachSQW(uint8_t pin) {
+	// INTCN = 0, RS2:RS1 = 00 : 1 Hz square wave, falling edge at rollover
+	_rtc->writeAddr(DS3231_CONTROL, _rtc->readAddr(DS3231_CONTROL) & ~0x1C);
+	pinMode(pin, INPUT_PULLUP);
+	_edgesSeen = _edges;
+	attachInterrupt(digitalPinToInterrupt(pin), onEdge, FALLING);
+}
+
+bool CprE_rtcClock::update() {
+	// the 64-bit stamp is two words, the ISR may run between their reads
+	portENTER_CRITICAL(&_edgeMux);
+	uint32_t edges = _edges;
+	int64_t e = _edgeUs;
+	portEXIT_CRITICAL(&_edgeMux);
+	if(edges != _edgesSeen) {
+		// SQW edge : whole second since the anchor, no I2C needed
+		_edgesSeen = edges;
+		move(_anchorSec + (uint32_t)((e - _anchorUs + 500000) / 1000000), e);
+		_lastSync = e;
+		return true;
+	}
+	int64_t t = esp_timer_get_time();
+	if(!_seeking) {
+		if(_resync == 0 || t - _lastSync < (int64_t)_resync * 1000000) 
+			return false;
+		_seeking = true;
+		_seekSec = readSeconds();
+		_lastRead = t;
+		return false;
+	}
+	// waiting for rollover, one 1 byte read every 2 ms
+	if(t - _lastRead < 2000) 
+		return false;
+	if(t - _lastRead > 100000) {
+		// update() was not called for a while, the rollover may be long gone
+		_seekSec = readSeconds();
+		_lastRead = t;
+		return false;
+	}
+	_lastRead = t;
+	if(readSeconds() == _seekSec) 
+		return false;
+	anchor(t);
+	_seeking = false;
+	return true;
+}
+
+uint32_t CprE_rtcClock::now() {
+	if(_slewFrom == 0 && _slewTo == 0) 
+		return _anchorSec + (uint32_t)((esp_timer_get_time() - _anchorUs) / 1000000);
+	return nowMicros() / 1000000;
+}
+
+uint64_t CprE_rtcClock::nowMicros() {
+	int64_t t = esp_timer_get_time();
+	return (uint64_t)_anchorSec * 1000000 + (t - _anchorUs) + offsetAt(t);
+}
+
+// slew in progress : moves from _slewFrom to _slewTo at CLOCK_SLEW_PPM
+int64_t CprE_rtcClock::offsetAt(int64_t t) {
+	int64_t d = _slewTo - _slewFrom;
+	int64_t max = (t - _slewStart) * CLOCK_SLEW_PPM / 1000000;
+	if(d > max) 
+		return _slewFrom + max;
+	if(d < -max) 
+		return _slewFrom - max;
+	return _slewTo;
+}
+
+int64_t CprE_rtcClock::offset() {
+	return offsetAt(esp_timer_get_time());
+}
+
+void CprE_rtcClock::slew(int32_t us) {
+	int64_t t = esp_timer_get_time();
+	_slewFrom = offsetAt(t);
+	_slewTo = _slewFrom + us;
+	_slewStart = t;
+}
+
+DateTime CprE_rtcClock::dateTime() {
+	return DateTime(now());
+}
+
+void CprE_rtcClock::adjust(uint32_t secs) {
+	// DS3231 restarts its second when the seconds register is written
+	int64_t t = esp_timer_get_time();
+	_rtc->adjust(DateTime(secs));
+	_anchorSec = secs;
+	_anchorUs = t;
+	_slewFrom = _slewTo = 0;
+	_lastSync = _anchorUs;
+	_seeking = false;
+}
+
+// days since 1970-01-01 to y/m/d (H. Hinnant's civil_from_days)
+static void civil(uint32_t days, uint16_t &y, uint8_t &m, uint8_t &d) {
+	uint32_t z = days + 719468;
+	uint32_t era = z / 146097;
+	uint32_t doe = z - era * 146097;
+	uint32_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+	uint32_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+	uint32_t mp = (5*doy + 2) / 153;
+	d = doy - (153*mp + 2)/5 + 1;
+	m = mp < 10 ? mp + 3 : mp - 9;
+	y = yoe + era * 400 + (m <= 2);
+}
+
+static char* put2(char* p, uint8_t v) {
+	*p++ = '0' + v / 10;
+	*p++ = '0' + v % 10;
+	return p;
+}
+
+size_t CprE_rtcClock::iso8601(char* buf, size_t size, uint64_t us, bool ms) {
+	if(size < (ms ? 24 : 20)) 
+		return 0;
+	uint32_t secs = us / 1000000;
+	uint32_t sec = secs % 86400;
+	uint16_t y;
+	uint8_t m, d;
+	civil(secs / 86400, y, m, d);
+	char* p = buf;
+	p = put2(p, y / 100);
+	p = put2(p, y % 100);
+	*p++ = '-';
+	p = put2(p, m);
+	*p++ = '-';
+	p = put2(p, d);
+	*p++ = 'T';
+	p = put2(p, sec / 3600);
+	*p++ = ':';
+	p = put2(p, sec / 60 % 60);
+	*p++ = ':';
+	p = put2(p, sec % 60);
+	if(ms) {
+		uint16_t f = (us / 1000) % 1000;
+		*p++ = '.';
+		*p++ = '0' + f / 100;
+		p = put2(p, f % 100);
+	}
+	*p = '\0';
+	return p - buf;
+}
+
+size_t CprE_rtcClock::timeOfDay(char* buf, size_t size, uint32_t secs) {
+	if(size < 9) 
+		return 0;
+	uint32_t sec = secs % 86400;
+	char* p = buf;
+	p = put2(p, sec / 3600);
+	*p++ = ':';
+	p = put2(p, sec / 60 % 60);
+	*p++ = ':';
+	p = put2(p, sec % 60);
+	*p = '\0';
+	return 8;
+}
+
+size_t CprE_rtcClock::epoch(char* buf, size_t size, uint32_t secs) {
+	char t[11];
+	uint8_t n = 0;
+	do {
+		t[n++] = '0' + secs % 10;
+		secs /= 10;
+	} while(secs);
+	if(size <= n) 
+		return 0;
+	for(uint8_t i=0; i<n; i++) 
+		buf[i] = t[n-1-i];
+	buf[n] = '\0';
+	return n;
+}
+
+size_t CprE_rtcClock::iso8601(char* buf, size_t size, bool ms) {
+	return iso8601(buf, size, nowMicros(), ms);
+}
+
+size_t CprE_rtcClock::timeOfDay(char* buf, size_t size) {
+	return timeOfDay(buf, size, now());
+}
+
+size_t CprE_rtcClock::epoch(char* buf, size_t size) {
+	return epoch(buf, size, now());
+}
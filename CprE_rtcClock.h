@@ -0,0 +1,70 @@
+#ifndef CPRE_RTC_CLOCK_H
+#define CPRE_RTC_CLOCK_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "CprE_DS3231.h"
+
+#define CLOCK_RESYNC	3600	// s between DS3231 re-reads without SQW
+#define CLOCK_ISO_LEN	24		// "2020-12-08T06:00:00.000" + '\0'
+#define CLOCK_SLEW_PPM	500		// max rate of slew() corrections
+#define CLOCK_STEP		1000000	// us, larger re-anchor jumps are not slewed
+
+// Software clock anchored to the DS3231 : one read at begin(), after that
+// time comes from esp_timer. The anchor is taken at a seconds rollover so
+// it is good to the millisecond. It is refreshed every resync seconds by
+// watching the seconds register from update(), or on every edge of the
+// 1 Hz SQW output when attachSQW() is used. SQW takes the INT/SQW pin, so
+// the DS3231 alarms cannot interrupt at the same time.
+// slew() corrects the clock gradually, at most CLOCK_SLEW_PPM, so time
+// never jumps or runs backwards. The correction is kept on top of the
+// DS3231 and survives re-anchoring, adjust() drops it. The small jump of
+// a re-anchor (DS3231 drift against esp_timer) is slewed the same way.
+class CprE_rtcClock {
+	public:
+		bool begin(CprE_DS3231 &rtc, uint32_t resync = CLOCK_RESYNC);
+		void attachSQW(uint8_t pin);
+		bool update();					// call from loop(), true when re-anchored
+		
+		uint32_t now();					// unix time, seconds
+		uint64_t nowMicros();			// unix time, microseconds
+		DateTime dateTime();
+		void adjust(uint32_t secs);		// set DS3231 and the clock
+		void slew(int32_t us);			// correct by us, gradually
+		int64_t offset();				// correction applied so far, us
+		
+		// into caller buffers, return length without '\0'
+		static size_t iso8601(char* buf, size_t size, uint64_t us, bool ms = false);
+		static size_t timeOfDay(char* buf, size_t size, uint32_t secs);	// "hh:mm:ss"
+		static size_t epoch(char* buf, size_t size, uint32_t secs);
+		size_t iso8601(char* buf, size_t size, bool ms = false);
+		size_t timeOfDay(char* buf, size_t size);
+		size_t epoch(char* buf, size_t size);
+		
+	private:
+		CprE_DS3231* _rtc;
+		uint32_t _resync;
+		uint32_t _anchorSec;
+		int64_t _anchorUs;
+		int64_t _lastSync;
+		int64_t _lastRead;
+		bool _seeking = false;
+		uint8_t _seekSec;
+		uint32_t _edgesSeen = 0;
+		int64_t _slewFrom = 0;
+		int64_t _slewTo = 0;
+		int64_t _slewStart = 0;
+		bool _anchored = false;
+		
+		static volatile int64_t _edgeUs;	// 64-bit : read under _edgeMux
+		static volatile uint32_t _edges;
+		static portMUX_TYPE _edgeMux;
+		static void IRAM_ATTR onEdge();
+		
+		uint8_t readSeconds();
+		void anchor(int64_t us);
+		void move(uint32_t sec, int64_t us);
+		int64_t offsetAt(int64_t t);
+};
+
+#endif
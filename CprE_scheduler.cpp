@@ -0,0 +1,178 @@
+#include "CprE_scheduler.h"
+
+TaskHandle_t CprE_scheduler::_task = NULL;
+
+void IRAM_ATTR CprE_scheduler::isr() {
+	BaseType_t woken = pdFALSE;
+	if(_task) 
+		vTaskNotifyGiveFromISR(_task, &woken);
+	if(woken) 
+		portYIELD_FROM_ISR();
+}
+
+bool CprE_scheduler::begin(CprE_DS3231 &rtc, uint8_t intPin) {
+	_rtc = &rtc;
+	_pin = intPin;
+	_task = xTaskGetCurrentTaskHandle();
+	for(uint8_t i=0; i<SCHED_MAX_JOBS; i++) 
+		_job[i].active = false;
+	for(uint8_t l=0; l<SCHED_LEVELS; l++) 
+		for(uint8_t s=0; s<SCHED_SLOTS; s++) 
+			_slot[l][s] = -1;
+	_now = _rtc->now().unixtime();
+	_rtc->disableAlarm();
+	_rtc->clearFlag();
+	pinMode(_pin, INPUT_PULLUP);
+	attachInterrupt(digitalPinToInterrupt(_pin), isr, FALLING);
+	return true;
+}
+
+// level by distance from wheel time, slot by the due time bits of that level
+void CprE_scheduler::insert(int8_t id) {
+	uint32_t due = _job[id].due;
+	uint32_t delta = due - _now;
+	uint8_t level = 0;
+	while(level < SCHED_LEVELS - 1 && delta >= ((uint32_t)SCHED_SLOTS << (6 * level))) 
+		level++;
+	if(delta >= ((uint32_t)SCHED_SLOTS << (6 * level))) 
+		due = _now + ((uint32_t)(SCHED_SLOTS - 1) << (6 * level));	// beyond horizon, re-filed on cascade
+	uint8_t s = (due >> (6 * level)) & (SCHED_SLOTS - 1);
+	_job[id].next = _slot[level][s];
+	_slot[level][s] = id;
+}
+
+void CprE_scheduler::unlink(int8_t id) {
+	for(uint8_t l=0; l<SCHED_LEVELS; l++) {
+		for(uint8_t s=0; s<SCHED_SLOTS; s++) {
+			for(int8_t* p = &_slot[l][s]; *p >= 0; p = &_job[*p].next) {
+				if(*p == id) {
+					*p = _job[id].next;
+					return;
+				}
+			}
+		}
+	}
+}
+
+// move the jobs of the slot now reached one level down
+void CprE_scheduler::cascade(uint8_t level) {
+	uint8_t s = (_now >> (6 * level)) & (SCHED_SLOTS - 1);
+	int8_t id = _slot[level][s];
+	_slot[level][s] = -1;
+	while(id >= 0) {
+		int8_t nx = _job[id].next;
+		insert(id);
+		id = nx;
+	}
+}
+
+int CprE_scheduler::every(uint32_t period, schedCallback cb, void* arg, uint32_t offset) {
+	if(period == 0) 
+		return -1;
+	for(int8_t i=0; i<SCHED_MAX_JOBS; i++) {
+		if(!_job[i].active) {
+			_job[i].cb = cb;
+			_job[i].arg = arg;
+			_job[i].period = period;
+			_job[i].due = (_now - offset % period) / period * period + offset % period;
+			if(_job[i].due <= _now) 
+				_job[i].due += period;
+			_job[i].active = true;
+			insert(i);
+			return i;
+		}
+	}
+	return -1;
+}
+
+void CprE_scheduler::cancel(int id) {
+	if(id < 0 || id >= SCHED_MAX_JOBS || !_job[id].active) 
+		return;
+	unlink(id);
+	_job[id].active = false;
+}
+
+void CprE_scheduler::advance(uint32_t now) {
+	while((int32_t)(now - _now) > 0) {
+		_now++;
+		for(uint8_t l=SCHED_LEVELS-1; l>0; l--) {
+			if((_now & ((1UL << (6 * l)) - 1)) == 0) 
+				cascade(l);
+		}
+		uint8_t s = _now & (SCHED_SLOTS - 1);
+		int8_t id = _slot[0][s];
+		_slot[0][s] = -1;
+		while(id >= 0) {
+			int8_t nx = _job[id].next;
+			if(_job[id].due == _now) {
+				_job[id].due += _job[id].period;
+				insert(id);		// before the callback, it may cancel itself
+				_job[id].cb(_job[id].arg);
+			}
+			else {
+				insert(id);
+			}
+			id = nx;
+		}
+	}
+}
+
+uint32_t CprE_scheduler::next() {
+	uint32_t best = 0;
+	for(uint8_t i=0; i<SCHED_MAX_JOBS; i++) {
+		if(_job[i].active && (best == 0 || (int32_t)(_job[i].due - best) < 0)) 
+			best = _job[i].due;
+	}
+	return best;
+}
+
+// Alarm1 on date, h, m, s of the earliest job
+void CprE_scheduler::program() {
+	DateTime w(next());
+	_rtc->hold();
+	_rtc->clearFlag();
+	_rtc->setAlarm1(w.hour(), w.minute(), w.second(), w.day(), false, 'M');
+	_rtc->enableAlarm(1);
+	_rtc->commit();
+}
+
+void CprE_scheduler::lightSleep(bool enable) {
+	_sleep = enable;
+}
+
+void CprE_scheduler::run() {
+	uint32_t due = next();
+	if(due == 0) 
+		return;
+	uint32_t now = _rtc->now().unixtime();
+	if((int32_t)(due - now) > 0) {
+		program();
+		// timer as safety net if the alarm edge is missed
+		uint32_t wait = due - now + 2;
+		ulTaskNotifyTake(pdTRUE, 0);		// drop a stale notification
+		if(_sleep) {
+			Serial.flush();
+			// the wakeup turns the pin interrupt into a low level one : keep
+			// it masked, INT/SQW stays low until clearFlag() below
+			gpio_intr_disable((gpio_num_t)_pin);
+			gpio_wakeup_enable((gpio_num_t)_pin, GPIO_INTR_LOW_LEVEL);
+			esp_sleep_enable_gpio_wakeup();
+			esp_sleep_enable_timer_wakeup((uint64_t)wait * 1000000);
+			esp_light_sleep_start();
+			gpio_wakeup_disable((gpio_num_t)_pin);
+			gpio_set_intr_type((gpio_num_t)_pin, GPIO_INTR_NEGEDGE);
+			gpio_intr_enable((gpio_num_t)_pin);
+		}
+		else {
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait * 1000));
+		}
+		_wakeups++;
+		_rtc->clearFlag();
+		now = _rtc->now().unixtime();
+	}
+	advance(now);
+}
+
+uint32_t CprE_scheduler::wakeups() {
+	return _wakeups;
+}
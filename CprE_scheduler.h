@@ -0,0 +1,64 @@
+#ifndef CPRE_SCHEDULER_H
+#define CPRE_SCHEDULER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include "CprE_DS3231.h"
+
+#define SCHED_MAX_JOBS	16
+#define SCHED_SLOTS		64		// slots per wheel level
+#define SCHED_LEVELS	3		// 1 s, 64 s, 4096 s per slot : ~3 days ahead
+
+typedef void (*schedCallback)(void* arg);
+
+struct schedJob {
+	schedCallback cb;
+	void* arg;
+	uint32_t period;		// s
+	uint32_t due;			// unix time of next run
+	int8_t next;			// next job in same wheel slot, -1 = end
+	bool active;
+};
+
+// Periodic jobs run from the DS3231 instead of millis() polling in loop().
+// Jobs sit in a hierarchical timer wheel, Alarm1 is programmed for the
+// earliest one and run() waits for it : light sleep, or blocked on a task
+// notification which is all the RTCINT interrupt does. Jobs then run in
+// the calling task. Alarm2 is left free for the sketch.
+class CprE_scheduler {
+	public:
+		bool begin(CprE_DS3231 &rtc, uint8_t intPin);
+		
+		// run cb every period s, at times where unix time % period == offset
+		// e.g. every(86400, daily, NULL, 3*3600) at 03:00. Returns id or -1
+		int every(uint32_t period, schedCallback cb, void* arg = NULL, uint32_t offset = 0);
+		void cancel(int id);
+		void lightSleep(bool enable);
+		
+		uint32_t next();				// due time of earliest job, 0 = none
+		void run();						// call from loop() : wait, then run due jobs
+		void advance(uint32_t now);		// run jobs due up to now
+		uint32_t wakeups();
+		
+	private:
+		CprE_DS3231* _rtc;
+		uint8_t _pin;
+		bool _sleep = false;
+		uint32_t _now = 0;				// wheel time
+		uint32_t _wakeups = 0;
+		schedJob _job[SCHED_MAX_JOBS];
+		int8_t _slot[SCHED_LEVELS][SCHED_SLOTS];
+		
+		static TaskHandle_t _task;
+		static void IRAM_ATTR isr();
+		
+		void insert(int8_t id);
+		void unlink(int8_t id);
+		void cascade(uint8_t level);
+		void program();
+};
+
+#endif
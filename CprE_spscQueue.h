@@ -0,0 +1,43 @@
+#ifndef CPRE_SPSC_QUEUE_H
+#define CPRE_SPSC_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free ring for exactly one producer task and one consumer task.
+// Holds N-1 items, each side only writes its own index.
+template <typename T, uint16_t N>
+class CprE_spscQueue {
+	public:
+		bool push(const T &item) {
+			uint16_t head = _head.load(std::memory_order_relaxed);
+			uint16_t next = (head+1) % N;
+			if(next == _tail.load(std::memory_order_acquire)) 
+				return false;			// full
+			_item[head] = item;
+			_head.store(next, std::memory_order_release);
+			return true;
+		}
+		
+		bool pop(T &item) {
+			uint16_t tail = _tail.load(std::memory_order_relaxed);
+			if(tail == _head.load(std::memory_order_acquire)) 
+				return false;			// empty
+			item = _item[tail];
+			_tail.store((tail+1) % N, std::memory_order_release);
+			return true;
+		}
+		
+		uint16_t size() {
+			uint16_t head = _head.load(std::memory_order_acquire);
+			uint16_t tail = _tail.load(std::memory_order_acquire);
+			return (head+N-tail) % N;
+		}
+		
+	private:
+		T _item[N];
+		std::atomic<uint16_t> _head{0};
+		std::atomic<uint16_t> _tail{0};
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "CprE_telemetry.h"
+#include <math.h>
+
+static uint32_t zigzag(int32_t v) {
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+	return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static int32_t toFixed(float value, float scale) {
+	double v = (double)value * scale;
+	if(v >= 2147483647.0) 
+		return INT32_MAX;
+	if(v <= -2147483648.0) 
+		return INT32_MIN;
+	return (int32_t)lround(v);
+}
+
+CprE_tmEncoder::CprE_tmEncoder(const tmSchema &schema, uint8_t* buf, size_t size) 
+	: _schema(schema), _buf(buf), _size(size) {
+	reset();
+}
+
+void CprE_tmEncoder::reset() {
+	_len = 0;
+	_overflow = false;
+	_field = 0;
+	for(uint8_t i=0; i<TM_MAX_FIELDS; i++) 
+		_prev[i] = 0;
+	if(_size >= TM_HEADER) {
+		_buf[0] = _schema.id;
+		_buf[1] = 0;
+		_len = TM_HEADER;
+	}
+	_mark = _len;
+}
+
+void CprE_tmEncoder::begin() {
+	_mark = _len;
+	_field = 0;
+	_overflow = _size < TM_HEADER || _schema.count > TM_MAX_FIELDS || _buf[1] == 0xFF;
+	for(uint8_t i=0; i<TM_MAX_FIELDS; i++) 
+		_saved[i] = _prev[i];
+}
+
+void CprE_tmEncoder::putRaw(int32_t v) {
+	if(_field >= _schema.count) {
+		_overflow = true;
+		return;
+	}
+	// difference in 32 bit wraps, the decoder wraps back the same way
+	uint32_t z = zigzag((int32_t)((uint32_t)v - (uint32_t)_prev[_field]));
+	_prev[_field++] = v;
+	do {
+		if(_len >= _size) {
+			_overflow = true;
+			return;
+		}
+		_buf[_len++] = (z & 0x7F) | (z > 0x7F ? 0x80 : 0);
+		z >>= 7;
+	} while(z);
+}
+
+void CprE_tmEncoder::put(float value) {
+	putRaw(toFixed(value, _field < _schema.count ? _schema.fields[_field].scale : 1));
+}
+
+void CprE_tmEncoder::putInt(int32_t value) {
+	putRaw(value);
+}
+
+bool CprE_tmEncoder::end() {
+	if(_overflow || _field != _schema.count) {
+		// drop the partial record
+		_len = _mark;
+		for(uint8_t i=0; i<TM_MAX_FIELDS; i++) 
+			_prev[i] = _saved[i];
+		return false;
+	}
+	_buf[1]++;
+	return true;
+}
+
+bool CprE_tmEncoder::add(const float* values) {
+	begin();
+	for(uint8_t i=0; i<_schema.count; i++) 
+		put(values[i]);
+	return end();
+}
+
+size_t CprE_tmEncoder::length() {
+	return _len;
+}
+
+uint8_t CprE_tmEncoder::records() {
+	return _size >= TM_HEADER ? _buf[1] : 0;
+}
+
+CprE_tmDecoder::CprE_tmDecoder(const uint8_t* buf, size_t len) 
+	: _buf(buf), _len(len), _pos(TM_HEADER), _done(0) {
+	for(uint8_t i=0; i<TM_MAX_FIELDS; i++) 
+		_prev[i] = 0;
+}
+
+uint8_t CprE_tmDecoder::schema() {
+	return _len >= TM_HEADER ? _buf[0] : 0;
+}
+
+uint8_t CprE_tmDecoder::records() {
+	return _len >= TM_HEADER ? _buf[1] : 0;
+}
+
+bool CprE_tmDecoder::nextRaw(const tmSchema &schema, int32_t* raw) {
+	if(_len < TM_HEADER || schema.id != _buf[0] || schema.count > TM_MAX_FIELDS) 
+		return false;
+	if(_done >= _buf[1]) 
+		return false;
+	for(uint8_t i=0; i<schema.count; i++) {
+		uint32_t z = 0;
+		uint8_t shift = 0;
+		uint8_t b;
+		do {
+			if(_pos >= _len || shift > 28) 
+				return false;		// truncated or malformed varint
+			b = _buf[_pos++];
+			z |= (uint32_t)(b & 0x7F) << shift;
+			shift += 7;
+		} while(b & 0x80);
+		_prev[i] = (int32_t)((uint32_t)_prev[i] + (uint32_t)unzigzag(z));
+		raw[i] = _prev[i];
+	}
+	_done++;
+	return true;
+}
+
+bool CprE_tmDecoder::next(const tmSchema &schema, double* values) {
+	int32_t raw[TM_MAX_FIELDS];
+	if(!nextRaw(schema, raw)) 
+		return false;
+	for(uint8_t i=0; i<schema.count; i++) 
+		values[i] = raw[i] / (double)schema.fields[i].scale;
+	return true;
+}
@@ -0,0 +1,78 @@
+#ifndef CPRE_TELEMETRY_H
+#define CPRE_TELEMETRY_H
+
+// No Arduino dependency : the same files build on the ingest server.
+#include <stdint.h>
+#include <stddef.h>
+
+#define TM_MAX_FIELDS	16		// fields per record
+#define TM_HEADER		2		// schema id, record count
+
+// One field of a record. Values are sent as round(value*scale), so
+// scale 100 keeps 2 decimals and scale 1 sends integers.
+struct tmField {
+	const char* name;
+	float scale;
+};
+
+struct tmSchema {
+	uint8_t id;
+	uint8_t count;
+	const tmField* fields;
+};
+
+// Packet : [schema id][record count] then for every record and field the
+// zigzag varint of the difference to the same field of the previous record
+// (the first record is sent as is). Slow changing values cost 1 byte.
+// Each packet decodes on its own, a lost datagram does not break the next.
+class CprE_tmEncoder {
+	public:
+		CprE_tmEncoder(const tmSchema &schema, uint8_t* buf, size_t size);
+		
+		// one record with schema.count values, false if it did not fit
+		bool add(const float* values);
+		
+		// field by field, for integers that do not fit a float (e.g. epoch)
+		void begin();
+		void put(float value);
+		void putInt(int32_t value);
+		bool end();
+		
+		size_t length();
+		uint8_t records();
+		void reset();
+		
+	private:
+		const tmSchema _schema;	// a copy : only the fields array must outlive the encoder
+		uint8_t* _buf;
+		size_t _size;
+		size_t _len;
+		size_t _mark;			// record start, rollback point
+		uint8_t _field;
+		bool _overflow;
+		int32_t _prev[TM_MAX_FIELDS];
+		int32_t _saved[TM_MAX_FIELDS];
+		
+		void putRaw(int32_t v);
+};
+
+class CprE_tmDecoder {
+	public:
+		CprE_tmDecoder(const uint8_t* buf, size_t len);
+		
+		uint8_t schema();		// id, to pick the schema for next()
+		uint8_t records();
+		
+		// next record into values[schema.count], false at end or on bad data
+		bool next(const tmSchema &schema, double* values);
+		bool nextRaw(const tmSchema &schema, int32_t* raw);
+		
+	private:
+		const uint8_t* _buf;
+		size_t _len;
+		size_t _pos;
+		uint8_t _done;
+		int32_t _prev[TM_MAX_FIELDS];
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "CprE_timeSync.h"
+
+#define NTP_UNIX_OFFSET	2208988800UL	// 1900-01-01 to 1970-01-01, s
+
+void CprE_timeSync::begin(CprE_DS3231 &rtc, CprE_rtcClock &clock, int32_t zone, uint32_t span) {
+	_rtc = &rtc;
+	_clock = &clock;
+	_zone = zone;
+	_span = span;
+	_synced = false;
+	_head = 0;
+	_count = 0;
+}
+
+bool CprE_timeSync::sample(uint64_t refUs, int64_t atUs) {
+	int64_t t = esp_timer_get_time();
+	int64_t local = (int64_t)_clock->nowMicros() - (t - atUs) - (int64_t)_zone * 1000000;
+	int64_t err = local - (int64_t)refUs;
+	_error = err > INT32_MAX ? INT32_MAX : err < INT32_MIN ? INT32_MIN : err;
+	if(!_synced || err > SYNC_STEP || err < -SYNC_STEP) {
+		step(refUs, atUs);
+		_steps++;
+		_head = 0;
+		_count = 0;
+		return true;
+	}
+	_clock->slew(-err);
+	// DS3231 against the reference, slews taken out
+	int64_t raw = err - _clock->offset();
+	uint32_t secs = refUs / 1000000;
+	// spaced so the ring holds about twice the span
+	if(_count == 0 || secs - _t[(_head + SYNC_SAMPLES - 1) % SYNC_SAMPLES] >= _span / (SYNC_SAMPLES / 2)) {
+		_t[_head] = secs;
+		_e[_head] = raw;
+		_head = (_head + 1) % SYNC_SAMPLES;
+		if(_count < SYNC_SAMPLES) 
+			_count++;
+		fit();
+	}
+	if(raw > SYNC_STEP / 2 || raw < -SYNC_STEP / 2) {
+		// keep the DS3231 itself within half a second for the next boot.
+		// The clock shows the right time already so the step does not show,
+		// the samples move with the DS3231 and the fit goes on
+		step(refUs, atUs);
+		for(uint8_t i=0; i<SYNC_SAMPLES; i++) 
+			_e[i] -= raw;
+	}
+	return true;
+}
+
+// write the DS3231 on the next reference second, its countdown chain
+// restarts with the write so the phase is right as well
+void CprE_timeSync::step(uint64_t refUs, int64_t atUs) {
+	uint64_t ref = refUs + (esp_timer_get_time() - atUs);
+	uint32_t next = ref / 1000000 + 1;
+	int64_t until = esp_timer_get_time() + ((uint64_t)next * 1000000 - ref);
+	int64_t wait = until - esp_timer_get_time();
+	if(wait > 2000) 
+		delay((wait - 2000) / 1000);
+	wait = until - esp_timer_get_time();
+	if(wait > 0) 
+		delayMicroseconds(wait);
+	_clock->adjust(next + _zone);
+	_synced = true;
+}
+
+// least squares slope of the uncorrected error, us per s is ppm
+void CprE_timeSync::fit() {
+	if(_count < 3) 
+		return;
+	uint8_t first = (_head + SYNC_SAMPLES - _count) % SYNC_SAMPLES;
+	uint8_t last = (_head + SYNC_SAMPLES - 1) % SYNC_SAMPLES;
+	if(_t[last] - _t[first] < _span) 
+		return;
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for(uint8_t i=0; i<_count; i++) {
+		uint8_t k = (first + i) % SYNC_SAMPLES;
+		double x = _t[k] - _t[first];
+		double y = _e[k];
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+	}
+	double d = _count * sxx - sx * sx;
+	if(d <= 0) 
+		return;
+	_drift = (_count * sxy - sx * sy) / d;
+	int8_t aging = _rtc->agingOffset();
+	long a = aging + lround(_drift / SYNC_PPM_LSB);
+	if(a > 127) 
+		a = 127;
+	if(a < -128) 
+		a = -128;
+	if(a == aging) 
+		return;
+	_rtc->setAgingOffset(a);
+	_agingUpdates++;
+	// the drift changes with the new offset, fit again from the last sample
+	_t[0] = _t[last];
+	_e[0] = _e[last];
+	_head = 1;
+	_count = 1;
+}
+
+static uint64_t ntpMicros(const uint8_t* p) {
+	uint32_t s = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+	uint32_t f = (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | p[7];
+	return (uint64_t)(s - NTP_UNIX_OFFSET) * 1000000 + (((uint64_t)f * 1000000) >> 32);
+}
+
+bool CprE_timeSync::sntp(UDP &udp, const char* server, uint64_t &refUs, int64_t &atUs, uint16_t timeout) {
+	uint8_t pkt[48] = {0x23};	// LI 0, version 4, client
+	while(udp.parsePacket() > 0) 
+		;	// drop late replies
+	if(!udp.beginPacket(server, NTP_PORT)) 
+		return false;
+	udp.write(pkt, sizeof(pkt));
+	int64_t t1 = esp_timer_get_time();
+	if(!udp.endPacket()) 
+		return false;
+	while(esp_timer_get_time() - t1 < (int64_t)timeout * 1000) {
+		if(udp.parsePacket() >= 48) {
+			int64_t t4 = esp_timer_get_time();
+			// server mode, stratum 0 is a kiss-o'-death
+			if(udp.read(pkt, sizeof(pkt)) != sizeof(pkt) || (pkt[0] & 0x07) != 4 || pkt[1] == 0) 
+				return false;
+			uint64_t t2 = ntpMicros(pkt + 32);
+			uint64_t t3 = ntpMicros(pkt + 40);
+			int64_t rtt = (t4 - t1) - (int64_t)(t3 - t2);
+			if(rtt > SYNC_MAX_RTT) 
+				return false;
+			refUs = t3 + rtt / 2;
+			atUs = t4;
+			return true;
+		}
+		delay(1);
+	}
+	return false;
+}
+
+bool CprE_timeSync::sampleNTP(UDP &udp, const char* server, uint16_t timeout) {
+	uint64_t ref;
+	int64_t at;
+	if(!sntp(udp, server, ref, at, timeout)) 
+		return false;
+	return sample(ref, at);
+}
+
+// AT+CCLK? has whole seconds : read until the second changes, the
+// rollover is between the previous and this reading
+bool CprE_timeSync::sampleModem(CprE_NB_bc95 &modem) {
+	int64_t start = esp_timer_get_time();
+	uint32_t first = modem.networkTime();
+	int64_t prev = (start + esp_timer_get_time()) / 2;
+	if(first == 0) 
+		return false;
+	while(esp_timer_get_time() - start < 1500000) {
+		int64_t a = esp_timer_get_time();
+		uint32_t t = modem.networkTime();
+		int64_t mid = (a + esp_timer_get_time()) / 2;
+		if(t == 0) 
+			return false;
+		if(t != first) 
+			return sample((uint64_t)t * 1000000, (prev + mid) / 2);
+		prev = mid;
+	}
+	return false;
+}
+
+bool CprE_timeSync::synced() {
+	return _synced;
+}
+
+int32_t CprE_timeSync::error() {
+	return _error;
+}
+
+float CprE_timeSync::drift() {
+	return _drift;
+}
+
+uint32_t CprE_timeSync::steps() {
+	return _steps;
+}
+
+uint32_t CprE_timeSync::agingUpdates() {
+	return _agingUpdates;
+}
@@ -0,0 +1,63 @@
+#ifndef CPRE_TIME_SYNC_H
+#define CPRE_TIME_SYNC_H
+
+#include <Arduino.h>
+#include <Udp.h>
+#include <esp_timer.h>
+#include "CprE_DS3231.h"
+#include "CprE_rtcClock.h"
+#include "CprE_NB_bc95.h"
+
+#define SYNC_SAMPLES	16			// error samples kept for the drift fit
+#define SYNC_SPAN		86400		// s of samples before the aging offset is touched
+#define SYNC_STEP		1000000		// us, larger errors are stepped, smaller slewed
+#define SYNC_MAX_RTT	250000		// us, slower NTP replies are dropped
+#define SYNC_PPM_LSB	0.1f		// DS3231 aging offset, ppm per LSB at 25 C
+#define NTP_PORT		123
+
+// Disciplines the DS3231 and a CprE_rtcClock against a reference : SNTP
+// over any UDP (WiFiUDP) or the network time of the BC95 (AT+CCLK?).
+// Each sample measures the clock error. The first sample, or an error over
+// SYNC_STEP, steps the DS3231 right on a reference second so it is in
+// phase to the millisecond. Smaller errors are slewed on the software
+// clock. The DS3231 error without corrections is fitted over at least
+// span seconds, the drift found is written to the aging offset register
+// (positive slows the oscillator) and the fit starts over. The register is
+// battery backed, the samples are not.
+// zone : seconds the DS3231 runs ahead of UTC (25200 for local time, +7).
+class CprE_timeSync {
+	public:
+		void begin(CprE_DS3231 &rtc, CprE_rtcClock &clock, int32_t zone = 0, uint32_t span = SYNC_SPAN);
+		bool sample(uint64_t refUs, int64_t atUs);		// reference unix us (UTC) valid at esp_timer atUs
+		bool sampleNTP(UDP &udp, const char* server, uint16_t timeout = 1000);
+		bool sampleModem(CprE_NB_bc95 &modem);
+
+		// SNTP request, udp.begin() must have been called
+		static bool sntp(UDP &udp, const char* server, uint64_t &refUs, int64_t &atUs, uint16_t timeout = 1000);
+
+		bool synced();
+		int32_t error();			// last measured error, us, + = clock ahead
+		float drift();				// last drift fit, ppm, + = DS3231 fast
+		uint32_t steps();			// step corrections made
+		uint32_t agingUpdates();	// aging offset writes
+
+	private:
+		CprE_DS3231* _rtc;
+		CprE_rtcClock* _clock;
+		int32_t _zone;
+		uint32_t _span;
+		bool _synced = false;
+		int32_t _error = 0;
+		float _drift = 0;
+		uint32_t _steps = 0;
+		uint32_t _agingUpdates = 0;
+		uint32_t _t[SYNC_SAMPLES];	// reference time, s
+		int32_t _e[SYNC_SAMPLES];	// DS3231 error without corrections, us
+		uint8_t _head = 0;
+		uint8_t _count = 0;
+
+		void step(uint64_t refUs, int64_t atUs);
+		void fit();
+};
+
+#endif
@@ -0,0 +1,374 @@
+#include "CprE_tsFile.h"
+#include "CprE_rtcClock.h"
+
+// little endian, as the ESP32
+static void put16(uint8_t* p, uint16_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+	for(uint8_t i=0; i<4; i++) 
+		p[i] = v >> (8 * i);
+}
+
+static uint16_t get16(const uint8_t* p) {
+	return p[0] | (uint16_t)p[1] << 8;
+}
+
+static uint32_t get32(const uint8_t* p) {
+	return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// header : 16 bytes fixed part then 16 bytes per field, whole sectors
+static uint32_t headerSize(uint16_t fields) {
+	return (16 + 16 * (uint32_t)fields + TS_SECTOR - 1) / TS_SECTOR * TS_SECTOR;
+}
+
+static bool readAt(File &f, uint32_t pos, uint8_t* buf, size_t len) {
+	return f.seek(pos) && f.read(buf, len) == len;
+}
+
+// CRC16 of a block, its own field left out
+static uint16_t blockCrc(const uint8_t* b, uint32_t size) {
+	uint16_t crc = CprE_crc16::compute(b, 12);
+	return CprE_crc16::compute(crc, b + TS_BLOCK_HEAD, size - TS_BLOCK_HEAD);
+}
+
+static bool blockValid(const uint8_t* b, uint32_t size, uint16_t rows) {
+	uint16_t count = get16(b + 2);
+	return get16(b) == TS_BLOCK_MAGIC && count > 0 && count <= rows && get16(b + 12) == blockCrc(b, size);
+}
+
+// index at the end of a closed segment : block count without a scan
+static bool readIndex(File &f, uint32_t header, uint32_t blockSize, uint32_t &blocks) {
+	uint32_t size = f.size();
+	uint8_t t[8];
+	if(size < header + 8 || !readAt(f, size - 8, t, 8) || get32(t + 4) != TS_INDEX_MAGIC) 
+		return false;
+	blocks = get32(t);
+	return header + blocks * (blockSize + 8) + 8 == size;
+}
+
+// segment without index : count the blocks that check, read into buf
+static uint32_t scanBlocks(File &f, uint32_t header, uint32_t blockSize, uint16_t rows, uint8_t* buf) {
+	uint32_t size = f.size();
+	uint32_t n = 0;
+	while(header + (n + 1) * blockSize <= size && readAt(f, header + n * blockSize, buf, blockSize)) {
+		if(!blockValid(buf, blockSize, rows)) 
+			break;
+		n++;
+	}
+	return n;
+}
+
+bool CprE_tsWriter::begin(fs::FS &fs, const char* path, const tmSchema &schema, uint8_t* buf, size_t size) {
+	_buf = buf;
+	_blockSize = size / TS_SECTOR * TS_SECTOR;
+	_fields = schema.count;
+	_header = headerSize(_fields);
+	_rows = _blockSize > TS_BLOCK_HEAD ? (_blockSize - TS_BLOCK_HEAD) / (4 + 4 * (uint32_t)_fields) : 0;
+	_block = 0;
+	_count = 0;
+	_dirty = false;
+	if(_rows == 0 || _fields == 0) 
+		return false;
+	if(!fs.exists(path)) {
+		_file = fs.open(path, FILE_WRITE);
+		if(!_file) 
+			return false;
+		// one sector at a time, 32 slots of 16 bytes : fixed part then fields
+		uint8_t sec[TS_SECTOR];
+		for(uint32_t s=0; s<_header/TS_SECTOR; s++) {
+			memset(sec, 0, sizeof(sec));
+			for(uint16_t j=0; j<TS_SECTOR/16; j++) {
+				uint32_t slot = s * (TS_SECTOR / 16) + j;
+				uint8_t* p = sec + j * 16;
+				if(slot == 0) {
+					put32(p, TS_MAGIC);
+					put16(p + 4, _fields);
+					put16(p + 6, _rows);
+					put32(p + 8, _blockSize);
+					p[12] = schema.id;
+				}
+				else if(slot <= _fields) {
+					strncpy((char*)p, schema.fields[slot - 1].name, TS_NAME_LEN - 1);
+					memcpy(p + TS_NAME_LEN, &schema.fields[slot - 1].scale, 4);
+				}
+			}
+			if(_file.write(sec, TS_SECTOR) != TS_SECTOR) {
+				_file.close();
+				return false;
+			}
+		}
+		_file.close();
+		_file = fs.open(path, "r+");
+		return (bool)_file;
+	}
+	_file = fs.open(path, "r+");
+	uint8_t h[16];
+	if(!_file || !readAt(_file, 0, h, 16) || get32(h) != TS_MAGIC || get16(h + 4) != _fields
+		|| get16(h + 6) != _rows || get32(h + 8) != _blockSize) {
+		_file.close();
+		return false;
+	}
+	uint32_t n;
+	if(readIndex(_file, _header, _blockSize, n)) {
+		// blocks will overwrite the index, drop its magic first
+		uint8_t zero[4] = {0};
+		_file.seek(_file.size() - 4);
+		_file.write(zero, 4);
+	}
+	else 
+		n = scanBlocks(_file, _header, _blockSize, _rows, _buf);
+	// go on with the last block when it has room
+	_block = n;
+	if(n > 0 && readAt(_file, _header + (n - 1) * _blockSize, _buf, _blockSize)
+		&& blockValid(_buf, _blockSize, _rows) && get16(_buf + 2) < _rows) {
+		_block = n - 1;
+		_count = get16(_buf + 2);
+	}
+	return true;
+}
+
+bool CprE_tsWriter::writeBlock() {
+	put16(_buf + 12, blockCrc(_buf, _blockSize));
+	if(!_file.seek(_header + _block * _blockSize) || _file.write(_buf, _blockSize) != _blockSize) 
+		return false;
+	_dirty = false;
+	return true;
+}
+
+bool CprE_tsWriter::append(uint32_t t, const float* values) {
+	if(!_file) 
+		return false;
+	if(_count == _rows) {
+		// full block that could not be written before
+		if(!writeBlock()) 
+			return false;
+		_block++;
+		_count = 0;
+	}
+	if(_count == 0) {
+		put16(_buf, TS_BLOCK_MAGIC);
+		put32(_buf + 4, t);
+		put32(_buf + 8, t);
+	}
+	else {
+		if(t < get32(_buf + 4)) 
+			put32(_buf + 4, t);
+		if(t > get32(_buf + 8)) 
+			put32(_buf + 8, t);
+	}
+	uint8_t* col = _buf + TS_BLOCK_HEAD;
+	put32(col + 4 * _count, t);
+	for(uint16_t f=0; f<_fields; f++) 
+		memcpy(col + 4 * ((uint32_t)_rows * (f + 1) + _count), &values[f], 4);
+	_count++;
+	put16(_buf + 2, _count);
+	_dirty = true;
+	if(_count == _rows && writeBlock()) {
+		_block++;
+		_count = 0;
+	}
+	return true;
+}
+
+bool CprE_tsWriter::sync() {
+	if(!_file) 
+		return false;
+	if(_dirty && !writeBlock()) 
+		return false;
+	_file.flush();
+	return true;
+}
+
+bool CprE_tsWriter::end() {
+	if(!sync()) 
+		return false;
+	uint32_t n = blocks();
+	uint32_t pos = _header + n * _blockSize;
+	// index entries read back from the block headers, 64 at a time
+	uint8_t chunk[TS_SECTOR];
+	bool ok = true;
+	for(uint32_t k=0; k<n && ok; k+=TS_SECTOR/8) {
+		uint32_t m = n - k < TS_SECTOR/8 ? n - k : TS_SECTOR/8;
+		for(uint32_t i=0; i<m; i++) {
+			uint8_t h[TS_BLOCK_HEAD];
+			ok = ok && readAt(_file, _header + (k + i) * _blockSize, h, TS_BLOCK_HEAD);
+			memcpy(chunk + 8 * i, h + 4, 8);
+		}
+		ok = ok && _file.seek(pos) && _file.write(chunk, 8 * m) == 8 * m;
+		pos += 8 * m;
+	}
+	uint8_t tail[8];
+	put32(tail, n);
+	put32(tail + 4, TS_INDEX_MAGIC);
+	ok = ok && _file.seek(pos) && _file.write(tail, 8) == 8;
+	_file.close();
+	return ok;
+}
+
+uint32_t CprE_tsWriter::blocks() {
+	return _block + (_count > 0 ? 1 : 0);
+}
+
+uint16_t CprE_tsWriter::rowsPerBlock() {
+	return _rows;
+}
+
+bool CprE_tsReader::open(fs::FS &fs, const char* path, uint8_t* buf, size_t size) {
+	_buf = buf;
+	_file = fs.open(path, FILE_READ);
+	uint8_t h[16];
+	if(!_file || !readAt(_file, 0, h, 16) || get32(h) != TS_MAGIC) {
+		_file.close();
+		return false;
+	}
+	_fields = get16(h + 4);
+	_rows = get16(h + 6);
+	_blockSize = get32(h + 8);
+	// a damaged header must not size reads past buf : the rows are what
+	// the writer derives from the block size and the fields
+	if(_fields == 0 || _fields > 255 || _blockSize > size || _blockSize <= TS_BLOCK_HEAD
+		|| _blockSize % TS_SECTOR != 0 || _rows == 0 || _rows != (_blockSize - TS_BLOCK_HEAD) / (4 + 4 * (uint32_t)_fields)) {
+		_file.close();
+		return false;
+	}
+	_header = headerSize(_fields);
+	_indexed = readIndex(_file, _header, _blockSize, _blocks);
+	if(!_indexed) 
+		_blocks = scanBlocks(_file, _header, _blockSize, _rows, _buf);
+	_block = _blocks;
+	return true;
+}
+
+void CprE_tsReader::close() {
+	_file.close();
+}
+
+uint16_t CprE_tsReader::fields() {
+	return _fields;
+}
+
+uint32_t CprE_tsReader::blocks() {
+	return _blocks;
+}
+
+bool CprE_tsReader::indexed() {
+	return _indexed;
+}
+
+// name : TS_NAME_LEN bytes
+bool CprE_tsReader::field(uint16_t i, char* name, float* scale) {
+	uint8_t e[16];
+	if(i >= _fields || !readAt(_file, 16 + 16 * (uint32_t)i, e, 16)) 
+		return false;
+	memcpy(name, e, TS_NAME_LEN);
+	name[TS_NAME_LEN - 1] = '\0';
+	if(scale) 
+		memcpy(scale, e + TS_NAME_LEN, 4);
+	return true;
+}
+
+bool CprE_tsReader::range(uint32_t k, uint32_t &tmin, uint32_t &tmax) {
+	uint8_t e[TS_BLOCK_HEAD];
+	if(_indexed) {
+		if(!readAt(_file, _header + _blocks * _blockSize + 8 * k, e + 4, 8)) 
+			return false;
+	}
+	else if(!readAt(_file, _header + k * _blockSize, e, TS_BLOCK_HEAD)) 
+		return false;
+	tmin = get32(e + 4);
+	tmax = get32(e + 8);
+	return true;
+}
+
+bool CprE_tsReader::load(uint32_t k) {
+	_block = _blocks;
+	if(k >= _blocks || !readAt(_file, _header + k * _blockSize, _buf, _blockSize) || !blockValid(_buf, _blockSize, _rows)) 
+		return false;
+	_block = k;
+	_count = get16(_buf + 2);
+	_row = 0;
+	return true;
+}
+
+bool CprE_tsReader::seek(uint32_t from, uint32_t to) {
+	_from = from;
+	_to = to;
+	// first block that ends at or after from
+	uint32_t lo = 0, hi = _blocks;
+	while(lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		uint32_t tmin, tmax;
+		if(!range(mid, tmin, tmax)) 
+			return false;
+		if(tmax < from) 
+			lo = mid + 1;
+		else 
+			hi = mid;
+	}
+	return load(lo);
+}
+
+int32_t CprE_tsReader::advance() {
+	while(_block < _blocks) {
+		while(_row < _count) {
+			uint16_t r = _row++;
+			uint32_t t = get32(_buf + TS_BLOCK_HEAD + 4 * r);
+			if(t >= _from && t <= _to) 
+				return r;
+		}
+		// next block, unless it starts after the range
+		uint32_t tmin, tmax;
+		if(_block + 1 >= _blocks || !range(_block + 1, tmin, tmax) || tmin > _to || !load(_block + 1)) 
+			_block = _blocks;
+	}
+	return -1;
+}
+
+bool CprE_tsReader::next(uint32_t &t, float* values) {
+	int32_t r = advance();
+	if(r < 0) 
+		return false;
+	const uint8_t* col = _buf + TS_BLOCK_HEAD;
+	t = get32(col + 4 * r);
+	for(uint16_t f=0; f<_fields; f++) 
+		memcpy(&values[f], col + 4 * ((uint32_t)_rows * (f + 1) + r), 4);
+	return true;
+}
+
+uint32_t CprE_tsReader::exportCSV(Print &out, uint32_t from, uint32_t to) {
+	uint8_t dec[256];
+	char name[TS_NAME_LEN];
+	out.print("time");
+	for(uint16_t f=0; f<_fields; f++) {
+		float scale = 1;
+		field(f, name, &scale);
+		out.print(',');
+		out.print(name);
+		for(dec[f]=0; scale >= 10 && dec[f] < 6; scale /= 10) 
+			dec[f]++;
+	}
+	out.print("\r\n");
+	if(!seek(from, to)) 
+		return 0;
+	uint32_t rows = 0;
+	char ts[CLOCK_ISO_LEN];
+	int32_t r;
+	while((r = advance()) >= 0) {
+		const uint8_t* col = _buf + TS_BLOCK_HEAD;
+		CprE_rtcClock::iso8601(ts, sizeof(ts), (uint64_t)get32(col + 4 * r) * 1000000);
+		out.print(ts);
+		for(uint16_t f=0; f<_fields; f++) {
+			float v;
+			memcpy(&v, col + 4 * ((uint32_t)_rows * (f + 1) + r), 4);
+			out.print(',');
+			out.print(v, dec[f]);
+		}
+		out.print("\r\n");
+		rows++;
+	}
+	return rows;
+}
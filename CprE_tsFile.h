@@ -0,0 +1,90 @@
+#ifndef CPRE_TS_FILE_H
+#define CPRE_TS_FILE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "CprE_crc16.h"
+#include "CprE_telemetry.h"
+
+#define TS_MAGIC		0x31465354	// "TSF1"
+#define TS_INDEX_MAGIC	0x58495354	// "TSIX"
+#define TS_BLOCK_MAGIC	0x4254		// "TB"
+#define TS_SECTOR		512
+#define TS_NAME_LEN		12			// field name in the header, '\0' included
+#define TS_BLOCK_HEAD	16			// magic, count, tmin, tmax, CRC16, 2 spare
+
+// Time series segment file, binary and column wise :
+//   header  : magic, fields, rows per block, block size, schema id, then
+//             per field name[12] and scale, padded to a sector
+//   blocks  : fixed size, [magic][count][tmin][tmax][CRC16], the timestamp
+//             column then one float column per field
+//   index   : written by end(), tmin/tmax of every block, block count and
+//             magic, so a reader finds a time range without reading blocks
+// Block k is at header + k * block size and the last block is rewritten in
+// place on sync(), so a segment without index (power cut) is still read by
+// scanning the block headers. The Modbus CRC16 over the whole block drops
+// a block torn by a cut during its rewrite, with the rows it held.
+// Time ranges assume increasing timestamps.
+// The block buffer is given by the caller, its size rounded down to whole
+// sectors is the block size : 4096 bytes hold 16 rows of 60 fields.
+class CprE_tsWriter {
+	public:
+		bool begin(fs::FS &fs, const char* path, const tmSchema &schema, uint8_t* buf, size_t size);
+		bool append(uint32_t t, const float* values);
+		bool sync();			// write the open block
+		bool end();				// sync, write the index and close
+
+		uint32_t blocks();		// blocks in the file, the open one included
+		uint16_t rowsPerBlock();
+
+	private:
+		File _file;
+		uint8_t* _buf = NULL;
+		uint32_t _blockSize;
+		uint32_t _header;
+		uint16_t _fields;
+		uint16_t _rows;
+		uint32_t _block = 0;	// open block
+		uint16_t _count = 0;	// rows in the open block
+		bool _dirty = false;
+
+		bool writeBlock();
+};
+
+class CprE_tsReader {
+	public:
+		bool open(fs::FS &fs, const char* path, uint8_t* buf, size_t size);
+		void close();
+
+		uint16_t fields();
+		uint32_t blocks();
+		bool indexed();			// index found, no scan was needed
+		bool field(uint16_t i, char* name, float* scale = NULL);
+
+		// rows with from <= t <= to, in file order
+		bool seek(uint32_t from, uint32_t to = 0xFFFFFFFF);
+		bool next(uint32_t &t, float* values);
+
+		// CSV with a header line, time as ISO 8601, decimals from the scales
+		uint32_t exportCSV(Print &out, uint32_t from = 0, uint32_t to = 0xFFFFFFFF);
+
+	private:
+		File _file;
+		uint8_t* _buf;
+		uint32_t _blockSize;
+		uint32_t _header;
+		uint16_t _fields;
+		uint16_t _rows;
+		uint32_t _blocks = 0;
+		bool _indexed = false;
+		uint32_t _from, _to;
+		uint32_t _block;		// loaded block, _blocks when none
+		uint16_t _count;
+		uint16_t _row;
+
+		bool range(uint32_t k, uint32_t &tmin, uint32_t &tmax);
+		bool load(uint32_t k);
+		int32_t advance();		// next matching row of the loaded block, -1 at the end
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "CprE_uplinkQueue.h"
+
+bool CprE_uplinkQueue::begin(fs::FS &fs, const char* path, uint32_t capacity) {
+	uint32_t hdr[5];
+	if(fs.exists(path)) {
+		_file = fs.open(path, "r+");
+		if(_file && _file.read((uint8_t*)hdr, UQ_HEADER) == UQ_HEADER 
+			&& hdr[0] == UQ_MAGIC && hdr[1] == capacity && hdr[2] < capacity && hdr[3] <= capacity) {
+			_cap = capacity;
+			_tail = hdr[2];
+			_used = hdr[3];
+			_count = hdr[4];
+			return true;
+		}
+		if(_file) 
+			_file.close();
+	}
+	// new or unusable queue file, start empty
+	_file = fs.open(path, "w");
+	if(!_file) 
+		return false;
+	_cap = capacity;
+	_tail = 0;
+	_used = 0;
+	_count = 0;
+	saveHeader();
+	_file.close();
+	_file = fs.open(path, "r+");
+	return (bool)_file;
+}
+
+void CprE_uplinkQueue::readRing(uint32_t pos, uint8_t* data, uint32_t len) {
+	pos %= _cap;
+	uint32_t first = min(len, _cap - pos);
+	_file.seek(UQ_HEADER + pos);
+	_file.read(data, first);
+	if(first < len) {
+		_file.seek(UQ_HEADER);
+		_file.read(data + first, len - first);
+	}
+}
+
+void CprE_uplinkQueue::writeRing(uint32_t pos, const uint8_t* data, uint32_t len) {
+	pos %= _cap;
+	uint32_t first = min(len, _cap - pos);
+	_file.seek(UQ_HEADER + pos);
+	_file.write(data, first);
+	if(first < len) {
+		_file.seek(UQ_HEADER);
+		_file.write(data + first, len - first);
+	}
+}
+
+// header is written after the data, a reset in between loses the record
+// but never leaves the ring inconsistent. Dropped records leave the ring
+// on disk before their bytes are reused
+void CprE_uplinkQueue::saveHeader() {
+	uint32_t hdr[5] = {UQ_MAGIC, _cap, _tail, _used, _count};
+	_file.seek(0);
+	_file.write((const uint8_t*)hdr, UQ_HEADER);
+	_file.flush();
+}
+
+bool CprE_uplinkQueue::push(const uint8_t* data, uint8_t len) {
+	if(!_file || len == 0 || (uint32_t)len + 1 > _cap) 
+		return false;
+	bool dropped = false;
+	while(_used + len + 1 > _cap) {
+		// full, drop the oldest record
+		uint8_t l;
+		readRing(_tail, &l, 1);
+		_tail = (_tail + l + 1) % _cap;
+		_used -= l + 1;
+		_count--;
+		_dropped++;
+		_peekUsed = 0;		// pending peek is no longer valid
+		_peekCount = 0;
+		dropped = true;
+	}
+	if(dropped) 
+		saveHeader();
+	uint32_t head = _tail + _used;
+	writeRing(head, &len, 1);
+	writeRing(head + 1, data, len);
+	_used += len + 1;
+	_count++;
+	saveHeader();
+	return true;
+}
+
+size_t CprE_uplinkQueue::peek(uint8_t* buf, size_t size) {
+	size_t n = 0;
+	_peekUsed = 0;
+	_peekCount = 0;
+	while(_peekCount < _count) {
+		uint8_t l;
+		readRing(_tail + _peekUsed, &l, 1);
+		if(n + l + 1 > size) 
+			break;
+		buf[n++] = l;
+		readRing(_tail + _peekUsed + 1, buf + n, l);
+		n += l;
+		_peekUsed += l + 1;
+		_peekCount++;
+	}
+	return n;
+}
+
+void CprE_uplinkQueue::ack() {
+	if(_peekCount == 0) 
+		return;
+	_tail = (_tail + _peekUsed) % _cap;
+	_used -= _peekUsed;
+	_count -= _peekCount;
+	_peekUsed = 0;
+	_peekCount = 0;
+	saveHeader();
+}
+
+int CprE_uplinkQueue::service(CprE_NB_bc95 &modem, const char* ip, const char* port) {
+	if(_count == 0 || millis() - _last < _interval) 
+		return 0;
+	_last = millis();
+	if(!_linkUp) {
+		_linkUp = modem.attached();
+		if(!_linkUp) 
+			return 0;
+	}
+	uint8_t dgram[MODEM_UDP_MAX];
+	int sent = 0;
+	while(sent < _burst && _count > 0) {
+		size_t n = peek(dgram, sizeof(dgram));
+		if(n == 0) 
+			break;
+		if(!modem.sendUDP(ip, port, dgram, n)) {
+			_linkUp = false;		// check attach again before next burst
+			break;
+		}
+		ack();
+		sent++;
+	}
+	return sent;
+}
+
+void CprE_uplinkQueue::setRate(unsigned long interval, uint8_t burst) {
+	_interval = interval;
+	_burst = burst;
+}
+
+uint32_t CprE_uplinkQueue::count() {
+	return _count;
+}
+
+uint32_t CprE_uplinkQueue::bytes() {
+	return _used;
+}
+
+uint32_t CprE_uplinkQueue::dropped() {
+	return _dropped;
+}
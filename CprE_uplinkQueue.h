@@ -0,0 +1,55 @@
+#ifndef CPRE_UPLINK_QUEUE_H
+#define CPRE_UPLINK_QUEUE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "CprE_NB_bc95.h"
+
+#define UQ_MAGIC	0x31515055	// "UPQ1"
+#define UQ_HEADER	20			// magic, capacity, tail, used, count
+#define UQ_INTERVAL	2000		// ms between drain bursts
+#define UQ_BURST	4			// datagrams per burst
+
+// Durable uplink queue : records are kept in a ring file on SPIFFS/SD and
+// survive reset or a lost network. The drain packs as many records as fit
+// into one datagram, [len][record][len][record]..., and only removes them
+// after the modem confirmed the send. When the ring is full the oldest
+// records are dropped.
+class CprE_uplinkQueue {
+	public:
+		bool begin(fs::FS &fs, const char* path, uint32_t capacity);
+		bool push(const uint8_t* data, uint8_t len);
+		
+		// pack oldest records into buf, ack() removes them once delivered
+		size_t peek(uint8_t* buf, size_t size);
+		void ack();
+		
+		// call from loop(), sends at most burst datagrams every interval
+		// when the modem is attached, returns datagrams sent
+		int service(CprE_NB_bc95 &modem, const char* ip, const char* port);
+		void setRate(unsigned long interval, uint8_t burst);
+		
+		uint32_t count();		// records waiting
+		uint32_t bytes();
+		uint32_t dropped();		// records lost to a full ring since begin()
+		
+	private:
+		File _file;
+		uint32_t _cap = 0;
+		uint32_t _tail = 0;
+		uint32_t _used = 0;
+		uint32_t _count = 0;
+		uint32_t _dropped = 0;
+		uint32_t _peekUsed = 0;
+		uint32_t _peekCount = 0;
+		unsigned long _interval = UQ_INTERVAL;
+		unsigned long _last = 0;
+		uint8_t _burst = UQ_BURST;
+		bool _linkUp = false;
+		
+		void readRing(uint32_t pos, uint8_t* data, uint32_t len);
+		void writeRing(uint32_t pos, const uint8_t* data, uint32_t len);
+		void saveHeader();
+};
+
+#endif
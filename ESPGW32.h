@@ -5,6 +5,22 @@
 #include "CprE_ModbusRTU.h"
 #include "CprE_DS3231.h"
 #include "CprE_NB_bc95.h"
+#include "CprE_busManager.h"
+#include "CprE_mbWriteBatch.h"
+#include "CprE_modbusCache.h"
+#include "CprE_modbusSlave.h"
+#include "CprE_mbProfile.h"
+#include "CprE_telemetry.h"
+#include "CprE_uplinkQueue.h"
+#include "CprE_coap.h"
+#include "CprE_nbSession.h"
+#include "CprE_rtcClock.h"
+#include "CprE_scheduler.h"
+#include "CprE_timeSync.h"
+#include "CprE_logWriter.h"
+#include "CprE_tsFile.h"
+#include "CprE_logStore.h"
+#include "CprE_backfill.h"
 
 #define SDA      26 
 #define SCL      25 
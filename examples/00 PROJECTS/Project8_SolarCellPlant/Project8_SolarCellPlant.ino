@@ -4,6 +4,8 @@
  * Description   : Send Solar Cell Plant infomation to server
  *                 via WiFi every 5 minutes (Also save log in SDcard)
  *                 and restart itself everyday at 6 am
+ *                 Packets missed while WiFi is down are kept in
+ *                 /backlog and sent again once it is back
  * Packet format : <projectName>,<date>,<time>,
  *                 [<AC1_?>,...],[<AC2_?>,...],[<AC3_?>,...],
  *                 [<AC4_?>,...],[<AC5_?>,...],[<DC1_?>,...],
@@ -28,14 +30,38 @@
 
 #define HOST        ""    // server ip
 #define PORT        ""    // server udp port
+#define BF_PORT     ""    // server udp port for backfill batches
 
 #define PLC_ADDR     1
 
 CprE_DS3231 rtc(SDA,SCL);
 CprE_modbusRTU m_rtu;
+CprE_mbPoller poller;
 WiFiUDP udp;
+CprE_logStore store;
+CprE_backfill backfill;
 NTPClient timeClient(udp, 25200);
 
+// PLC registers : AC meters at 100, 200, ... and DC meters at 600, 700, ...
+// one row per meter, the register maps are the library profiles
+#define N_METERS     9
+double meterValues[N_METERS][8];
+mbDevice meters[N_METERS] = {
+  {PLC_ADDR, &mbS7_1200_AC, meterValues[0], 100},
+  {PLC_ADDR, &mbS7_1200_AC, meterValues[1], 200},
+  {PLC_ADDR, &mbS7_1200_AC, meterValues[2], 300},
+  {PLC_ADDR, &mbS7_1200_AC, meterValues[3], 400},
+  {PLC_ADDR, &mbS7_1200_AC, meterValues[4], 500},
+  {PLC_ADDR, &mbS7_1200_DC, meterValues[5], 600},
+  {PLC_ADDR, &mbS7_1200_DC, meterValues[6], 700},
+  {PLC_ADDR, &mbS7_1200_DC, meterValues[7], 800},
+  {PLC_ADDR, &mbS7_1200_DC, meterValues[8], 900}
+};
+const char* meterNames[N_METERS] = {
+  "50kW No1", "50kW No2", "50kW No3", "125kW No1", "POWER METER ENERGY TOTAL SUMMING",
+  "DC_POWER_METER NO.1", "DC_POWER_METER NO.2", "DC_POWER_METER NO.3", "DC_POWER_METER NO.4"
+};
+
 int cntInt = 0;                     // interrupt flag
 unsigned long prev_t = 0;
 unsigned long interval = 300000;    // interval time of each packet
@@ -46,6 +72,7 @@ int mosi = 18;
 int cs = 14;
 const char *logFile = "/solardatalogs.txt";
 bool ntpUpdated = false;
+bool sd_en = true;
 unsigned long rtcTime_st;    // RTC time when setup() is running
 
 /******************** SDcard Functions ********************/
@@ -95,6 +122,7 @@ void setup() {
   Serial.begin(9600);
   Serial1.begin(9600,SERIAL_8N1,RXmax,TXmax);   // connect to RS485 device
   m_rtu.initSerial(Serial1, DIRPIN);
+  poller.begin(m_rtu, meters, N_METERS);
   delay(1000);
   
   Serial.println(F("# START"));
@@ -152,7 +180,6 @@ void setup() {
   attachInterrupt(digitalPinToInterrupt(RTCINT), isr, FALLING);
 
   // Initialize SD card Module
-  bool sd_en = true;
   Serial.print(F("# Initialize SD card..."));
   SPI.begin(sck, miso, mosi, cs);
   if(!SD.begin(cs)) {
@@ -175,34 +202,34 @@ void setup() {
       
                            "ACpm1_VoltA, ACpm1_VoltB, ACpm1_VoltC,"
                            "ACpm1_AmpA, ACpm1_AmpB, ACpm1_AmpC,"
-                           "ACpm1_Wtotal, ACpm1_kWh"
+                           "ACpm1_Wtotal, ACpm1_kWh,"
                            
                            "ACpm2_VoltA, ACpm2_VoltB, ACpm2_VoltC,"
                            "ACpm2_AmpA, ACpm2_AmpB, ACpm2_AmpC,"
-                           "ACpm2_Wtotal, ACpm2_kWh"
+                           "ACpm2_Wtotal, ACpm2_kWh,"
                            
                            "ACpm3_VoltA, ACpm3_VoltB, ACpm3_VoltC,"
                            "ACpm3_AmpA, ACpm3_AmpB, ACpm3_AmpC,"
-                           "ACpm3_Wtotal, ACpm3_kWh"
+                           "ACpm3_Wtotal, ACpm3_kWh,"
                            
                            "ACpm4_VoltA, ACpm4_VoltB, ACpm4_VoltC,"
                            "ACpm4_AmpA, ACpm4_AmpB, ACpm4_AmpC,"
-                           "ACpm4_Wtotal, ACpm4_kWh"
+                           "ACpm4_Wtotal, ACpm4_kWh,"
                            
                            "ACpm5_VoltA, ACpm5_VoltB, ACpm5_VoltC,"
                            "ACpm5_AmpA, ACpm5_AmpB, ACpm5_AmpC,"
-                           "ACpm5_Wtotal, ACpm5_kWh"
+                           "ACpm5_Wtotal, ACpm5_kWh,"
                            
-                           "DCpm1_Volt, DCpm1_Amp, DCpm1_Watt"
-                           "DCpm1_kWh, DCpm1_AmpHour"
+                           "DCpm1_Volt, DCpm1_Amp, DCpm1_Watt,"
+                           "DCpm1_kWh, DCpm1_AmpHour,"
                            
-                           "DCpm2_Volt, DCpm2_Amp, DCpm2_Watt"
-                           "DCpm2_kWh, DCpm2_AmpHour"
+                           "DCpm2_Volt, DCpm2_Amp, DCpm2_Watt,"
+                           "DCpm2_kWh, DCpm2_AmpHour,"
                            
-                           "DCpm3_Volt, DCpm3_Amp, DCpm3_Watt"
-                           "DCpm3_kWh, DCpm3_AmpHour"
+                           "DCpm3_Volt, DCpm3_Amp, DCpm3_Watt,"
+                           "DCpm3_kWh, DCpm3_AmpHour,"
                            
-                           "DCpm4_Volt, DCpm4_Amp, DCpm4_Watt"
+                           "DCpm4_Volt, DCpm4_Amp, DCpm4_Watt,"
                            "DCpm4_kWh, DCpm4_AmpHour"
                            
                            "\r\n";
@@ -214,6 +241,14 @@ void setup() {
       Serial.println(F("File already exists"));
     }
     file.close();
+    // records not sent while WiFi was down, sent later in batches of ~1 kB
+    if(store.begin(SD, "/backlog", rtc) && backfill.begin(SD, store, "/backlog/cursor")) {
+      backfill.setRate(1000, 2);
+    }
+    else {
+      Serial.println(F("Backlog on SDcard failed"));
+      sd_en = false;
+    }
   }
   if(!(wifi_en || sd_en)) {
     Serial.println(F("# Cannot connect to both WiFi and SDCard"));
@@ -245,360 +280,17 @@ void loop() {
 
     /***** Query data from PLC *****/
 
-    // AC_power_meter_1
-    
-    Serial.println(F("∙ 50kW No1"));
-    
-    m_rtu.sendReadHolding(PLC_ADDR,100,2);
-    float ACpm1_VoltA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_1 Volt A = "));
-    Serial.println(ACpm1_VoltA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,102,2);
-    float ACpm1_VoltB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_1 Volt B = "));
-    Serial.println(ACpm1_VoltB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,104,2);
-    float ACpm1_VoltC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_1 Volt C = "));
-    Serial.println(ACpm1_VoltC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,106,2);
-    float ACpm1_AmpA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_1 Amp A = "));
-    Serial.println(ACpm1_AmpA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,108,2);
-    float ACpm1_AmpB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_1 Amp B = "));
-    Serial.println(ACpm1_AmpB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,110,2);
-    float ACpm1_AmpC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_1 Amp C = "));
-    Serial.println(ACpm1_AmpC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,112,2);
-    float ACpm1_Wtotal = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_1 Watt total = "));
-    Serial.println(ACpm1_Wtotal);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,114,2);
-    float ACpm1_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_1 kWatt Hour = "));
-    Serial.println(ACpm1_kWh);
-    
-    Serial.println(F("=================================================="));
-    
-    // AC_power_meter_2
-    
-    Serial.println(F("∙ 50kW No2"));
-
-    m_rtu.sendReadHolding(PLC_ADDR,200,2);
-    float ACpm2_VoltA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_2 Volt A = "));
-    Serial.println(ACpm2_VoltA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,202,2);
-    float ACpm2_VoltB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_2 Volt B = "));
-    Serial.println(ACpm2_VoltB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,204,2);
-    float ACpm2_VoltC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_2 Volt C = "));
-    Serial.println(ACpm2_VoltC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,206,2);
-    float ACpm2_AmpA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_2 Amp A = "));
-    Serial.println(ACpm2_AmpA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,208,2);
-    float ACpm2_AmpB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_2 Amp B = "));
-    Serial.println(ACpm2_AmpB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,210,2);
-    float ACpm2_AmpC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_2 Amp C = "));
-    Serial.println(ACpm2_AmpC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,212,2);
-    float ACpm2_Wtotal = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_2 Watt total = "));
-    Serial.println(ACpm2_Wtotal);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,214,2);
-    float ACpm2_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_2 kWatt Hour = "));
-    Serial.println(ACpm2_kWh);
-    
-    Serial.println(F("=================================================="));
-        
-    // AC_power_meter_3 
-    
-    Serial.println(F("∙ 50kW No3"));
-
-    m_rtu.sendReadHolding(PLC_ADDR,300,2);
-    float ACpm3_VoltA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_3 Volt A = "));
-    Serial.println(ACpm3_VoltA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,302,2);
-    float ACpm3_VoltB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_3 Volt B = "));
-    Serial.println(ACpm3_VoltB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,304,2);
-    float ACpm3_VoltC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_3 Volt C = "));
-    Serial.println(ACpm3_VoltC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,306,2);
-    float ACpm3_AmpA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_3 Amp A = "));
-    Serial.println(ACpm3_AmpA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,308,2);
-    float ACpm3_AmpB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_3 Amp B = "));
-    Serial.println(ACpm3_AmpB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,310,2);
-    float ACpm3_AmpC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_3 Amp C = "));
-    Serial.println(ACpm3_AmpC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,312,2);
-    float ACpm3_Wtotal = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_3 Watt total = "));
-    Serial.println(ACpm3_Wtotal);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,314,2);
-    float ACpm3_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_3 kWatt Hour = "));
-    Serial.println(ACpm3_kWh);
-    
-    Serial.println(F("=================================================="));
-    
-    // AC_power_meter_4
-    
-    Serial.println(F("∙ 125kW No1"));
-
-    m_rtu.sendReadHolding(PLC_ADDR,400,2);
-    float ACpm4_VoltA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_4 Volt A = "));
-    Serial.println(ACpm4_VoltA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,402,2);
-    float ACpm4_VoltB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_4 Volt B = "));
-    Serial.println(ACpm4_VoltB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,404,2);
-    float ACpm4_VoltC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_4 Volt C = "));
-    Serial.println(ACpm4_VoltC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,406,2);
-    float ACpm4_AmpA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_4 Amp A = "));
-    Serial.println(ACpm4_AmpA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,408,2);
-    float ACpm4_AmpB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_4 Amp B = "));
-    Serial.println(ACpm4_AmpB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,410,2);
-    float ACpm4_AmpC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_4 Amp C = "));
-    Serial.println(ACpm4_AmpC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,412,2);
-    float ACpm4_Wtotal = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_4 Watt total = "));
-    Serial.println(ACpm4_Wtotal);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,414,2);
-    float ACpm4_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_4 kWatt Hour = "));
-    Serial.println(ACpm4_kWh);
-    
-    Serial.println(F("=================================================="));
-    
-    // AC_power_meter_5
-    
-    Serial.println(F("∙ POWER METER ENERGY TOTAL SUMMING"));
-
-    m_rtu.sendReadHolding(PLC_ADDR,500,2);
-    float ACpm5_VoltA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_5 Volt A = "));
-    Serial.println(ACpm5_VoltA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,502,2);
-    float ACpm5_VoltB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_5 Volt B = "));
-    Serial.println(ACpm5_VoltB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,504,2);
-    float ACpm5_VoltC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_5 Volt C = "));
-    Serial.println(ACpm5_VoltC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,506,2);
-    float ACpm5_AmpA = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_5 Amp A = "));
-    Serial.println(ACpm5_AmpA);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,508,2);
-    float ACpm5_AmpB = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_5 Amp B = "));
-    Serial.println(ACpm5_AmpB);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,510,2);
-    float ACpm5_AmpC = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_5 Amp C = "));
-    Serial.println(ACpm5_AmpC);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,512,2);
-    float ACpm5_Wtotal = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_5 Watt total = "));
-    Serial.println(ACpm5_Wtotal);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,514,2);
-    float ACpm5_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("AC_power_meter_5 kWatt Hour = "));
-    Serial.println(ACpm5_kWh);
-    
-    Serial.println(F("=================================================="));
-    
-    // DC_power_meter_1
-    
-    Serial.println(F("▲ DC_POWER_METER NO.1"));
-
-    m_rtu.sendReadHolding(PLC_ADDR,600,2);
-    float DCpm1_Volt = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_1 Volt = "));
-    Serial.println(DCpm1_Volt);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,602,2);
-    float DCpm1_Amp = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_1 AMP = "));
-    Serial.println(DCpm1_Amp);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,604,2);
-    float DCpm1_Watt = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_1 WATT = "));
-    Serial.println(DCpm1_Watt);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,606,2);
-    float DCpm1_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_1 KWH = "));
-    Serial.println(DCpm1_kWh);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,608,2);
-    float DCpm1_AmpHour = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_1 Amp_HOUR = "));
-    Serial.println(DCpm1_AmpHour);
-    
-    Serial.println(F("=================================================="));
-    
-    // DC_power_meter_2
-    
-    Serial.println(F("▲ DC_POWER_METER NO.2"));
-
-    m_rtu.sendReadHolding(PLC_ADDR,700,2);
-    float DCpm2_Volt = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_2 Volt = "));
-    Serial.println(DCpm2_Volt);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,702,2);
-    float DCpm2_Amp = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_2 AMP = "));
-    Serial.println(DCpm2_Amp);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,704,2);
-    float DCpm2_Watt = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_2 WATT = "));
-    Serial.println(DCpm2_Watt);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,706,2);
-    float DCpm2_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_2 KWH = "));
-    Serial.println(DCpm2_kWh);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,708,2);
-    float DCpm2_AmpHour = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_2 Amp_HOUR = "));
-    Serial.println(DCpm2_AmpHour);
-    
-    Serial.println(F("=================================================="));
-    
-    // DC_power_meter_3
-    
-    Serial.println(F("▲ DC_POWER_METER NO.3"));
-
-    m_rtu.sendReadHolding(PLC_ADDR,800,2);
-    float DCpm3_Volt = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_3 Volt = "));
-    Serial.println(DCpm3_Volt);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,802,2);
-    float DCpm3_Amp = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_3 AMP = "));
-    Serial.println(DCpm3_Amp);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,804,2);
-    float DCpm3_Watt = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_3 WATT = "));
-    Serial.println(DCpm3_Watt);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,806,2);
-    float DCpm3_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_3 KWH = "));
-    Serial.println(DCpm3_kWh);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,808,2);
-    float DCpm3_AmpHour = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_3 Amp_HOUR = "));
-    Serial.println(DCpm3_AmpHour);
-    
-    Serial.println(F("=================================================="));
-    
-    // DC_power_meter_4
-    
-    Serial.println(F("▲ DC_POWER_METER NO.4"));
+    int requests = poller.poll();
+    for(int i=0; i<N_METERS; i++) {
+      const mbProfile &p = *meters[i].profile;
+      Serial.println("∙ " + (String)meterNames[i]);
+      for(int k=0; k<p.count; k++) {
+        Serial.println((String)p.points[k].name + " = " + (String)meters[i].values[k] + " " + p.points[k].unit);
+      }
+      Serial.println(F("=================================================="));
+    }
+    Serial.println("Requests sent : " + (String)requests);
 
-    m_rtu.sendReadHolding(PLC_ADDR,900,2);
-    float DCpm4_Volt = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_4 Volt = "));
-    Serial.println(DCpm4_Volt);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,902,2);
-    float DCpm4_Amp = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_4 AMP = "));
-    Serial.println(DCpm4_Amp);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,904,2);
-    float DCpm4_Watt = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_4 WATT = "));
-    Serial.println(DCpm4_Watt);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,906,2);
-    float DCpm4_kWh = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_4 KWH = "));
-    Serial.println(DCpm4_kWh);
-    
-    m_rtu.sendReadHolding(PLC_ADDR,908,2);
-    float DCpm4_AmpHour = m_rtu.recv_float(PLC_ADDR);
-    Serial.print(F("DC_power_meter_4 Amp_HOUR = "));
-    Serial.println(DCpm4_AmpHour);
-    
-    Serial.println(F("=================================================="));
-    
     /***** Complete the packet *****/
     
     // Get timestamps
@@ -609,118 +301,40 @@ void loop() {
       dt = DateTime(rtcTime_st + (millis()/1000));
 
     // Build packet
-    String packet_h = "SolarCellPlant,";
-    packet_h += dt.timestamp(DateTime::TIMESTAMP_DATE);
-    packet_h += ",";
-    packet_h += dt.timestamp(DateTime::TIMESTAMP_TIME);
-                           
-    String packet_data_1 = "," + (String)ACpm1_VoltA  + "," + (String)ACpm1_VoltB +
-                           "," + (String)ACpm1_VoltC  + "," + (String)ACpm1_AmpA +
-                           "," + (String)ACpm1_AmpB   + "," + (String)ACpm1_AmpC +
-                           "," + (String)ACpm1_Wtotal + "," + (String)ACpm1_kWh;
-                           
-    String packet_data_2 = "," + (String)ACpm2_VoltA  + "," + (String)ACpm2_VoltB +
-                           "," + (String)ACpm2_VoltC  + "," + (String)ACpm2_AmpA +
-                           "," + (String)ACpm2_AmpB   + "," + (String)ACpm2_AmpC +
-                           "," + (String)ACpm2_Wtotal + "," + (String)ACpm2_kWh;
-                           
-    String packet_data_3 = "," + (String)ACpm3_VoltA  + "," + (String)ACpm3_VoltB +
-                           "," + (String)ACpm3_VoltC  + "," + (String)ACpm3_AmpA +
-                           "," + (String)ACpm3_AmpB   + "," + (String)ACpm3_AmpC +
-                           "," + (String)ACpm3_Wtotal + "," + (String)ACpm3_kWh;
-                           
-    String packet_data_4 = "," + (String)ACpm4_VoltA  + "," + (String)ACpm4_VoltB +
-                           "," + (String)ACpm4_VoltC  + "," + (String)ACpm4_AmpA +
-                           "," + (String)ACpm4_AmpB   + "," + (String)ACpm4_AmpC +
-                           "," + (String)ACpm4_Wtotal + "," + (String)ACpm4_kWh;
-                           
-    String packet_data_5 = "," + (String)ACpm5_VoltA  + "," + (String)ACpm5_VoltB +
-                           "," + (String)ACpm5_VoltC  + "," + (String)ACpm5_AmpA +
-                           "," + (String)ACpm5_AmpB   + "," + (String)ACpm5_AmpC +
-                           "," + (String)ACpm5_Wtotal + "," + (String)ACpm5_kWh;
-                           
-    String packet_data_6 = "," + (String)DCpm1_Volt + "," + (String)DCpm1_Amp +
-                           "," + (String)DCpm1_Watt + "," + (String)DCpm1_kWh +
-                           "," + (String)DCpm1_AmpHour;
-                           
-    String packet_data_7 = "," + (String)DCpm2_Volt + "," + (String)DCpm2_Amp +
-                           "," + (String)DCpm2_Watt + "," + (String)DCpm2_kWh +
-                           "," + (String)DCpm2_AmpHour;
-                           
-    String packet_data_8 = "," + (String)DCpm3_Volt + "," + (String)DCpm3_Amp +
-                           "," + (String)DCpm3_Watt + "," + (String)DCpm3_kWh +
-                           "," + (String)DCpm3_AmpHour;
-                           
-    String packet_data_9 = "," + (String)DCpm4_Volt + "," + (String)DCpm4_Amp +
-                           "," + (String)DCpm4_Watt + "," + (String)DCpm4_kWh +
-                           "," + (String)DCpm4_AmpHour;
+    String packet = "SolarCellPlant,";
+    packet += dt.timestamp(DateTime::TIMESTAMP_DATE);
+    packet += ",";
+    packet += dt.timestamp(DateTime::TIMESTAMP_TIME);
+    for(int i=0; i<N_METERS; i++) {
+      for(int k=0; k<meters[i].profile->count; k++) {
+        packet += "," + (String)meters[i].values[k];
+      }
+    }
 
     // Send and save the packet When there's no INTERRUPT
     if(cntInt == 0) {
       Serial.println("► Send the packet");
-      Serial.print(packet_h);
-      Serial.print(packet_data_1);
-      Serial.print(packet_data_2);
-      Serial.print(packet_data_3);
-      Serial.print(packet_data_4);
-      Serial.print(packet_data_5);
-      Serial.print(packet_data_6);
-      Serial.print(packet_data_7);
-      Serial.print(packet_data_8);
-      Serial.print(packet_data_9);
-      Serial.println();
+      Serial.println(packet);
       
+      // keep the packet until it went out (UDP : not a server receipt)
+      bool caughtUp = false;
+      if(sd_en) {
+        caughtUp = !backfill.pending();
+        store.append(packet.c_str());
+      }
+
       // send data via WiFi
-      uint8_t udpPack[150];
       udp.beginPacket(HOST, String(PORT).toInt());
-      
-      packet_h.getBytes(udpPack, packet_h.length()+1);
-      udp.write(udpPack, packet_h.length());
-      
-      packet_data_1.getBytes(udpPack, packet_data_1.length()+1);
-      udp.write(udpPack, packet_data_1.length());
-      
-      packet_data_2.getBytes(udpPack, packet_data_2.length()+1);
-      udp.write(udpPack, packet_data_2.length());
-      
-      packet_data_3.getBytes(udpPack, packet_data_3.length()+1);
-      udp.write(udpPack, packet_data_3.length());
-      
-      packet_data_4.getBytes(udpPack, packet_data_4.length()+1);
-      udp.write(udpPack, packet_data_4.length());
-      
-      packet_data_5.getBytes(udpPack, packet_data_5.length()+1);
-      udp.write(udpPack, packet_data_5.length());
-      
-      packet_data_6.getBytes(udpPack, packet_data_6.length()+1);
-      udp.write(udpPack, packet_data_6.length());
-      
-      packet_data_7.getBytes(udpPack, packet_data_7.length()+1);
-      udp.write(udpPack, packet_data_7.length());
-      
-      packet_data_8.getBytes(udpPack, packet_data_8.length()+1);
-      udp.write(udpPack, packet_data_8.length());
-      
-      packet_data_9.getBytes(udpPack, packet_data_9.length()+1);
-      udp.write(udpPack, packet_data_9.length());
-      
-      udp.endPacket();
-      memset(udpPack, 0, 150);  // clean buffer
+      udp.write((const uint8_t*)packet.c_str(), packet.length());
+      if(udp.endPacket() && WiFi.status() == WL_CONNECTED && caughtUp && sd_en) {
+        backfill.skip();        // nothing older is pending, this one went out
+      }
       
       // save data in SD-Card
       if(SD.begin(cs)) {
         Serial.println("Save data to SDcard.");
-        appendFile(SD, logFile, packet_h.c_str());
-        appendFile(SD, logFile, packet_data_1.c_str());
-        appendFile(SD, logFile, packet_data_2.c_str());
-        appendFile(SD, logFile, packet_data_3.c_str());
-        appendFile(SD, logFile, packet_data_4.c_str());
-        appendFile(SD, logFile, packet_data_5.c_str());
-        appendFile(SD, logFile, packet_data_6.c_str());
-        appendFile(SD, logFile, packet_data_7.c_str());
-        appendFile(SD, logFile, packet_data_8.c_str());
-        appendFile(SD, logFile, packet_data_9.c_str());
-        appendFile(SD, logFile, "\r\n");
+        packet += "\r\n";
+        appendFile(SD, logFile, packet.c_str());
       }
       else {
         Serial.println("SDcard is unavailable!");
@@ -731,6 +345,14 @@ void loop() {
     Serial.println();
   }
   
+  // send what could not go out while offline, a few datagrams at a time
+  if(sd_en) {
+    store.service();
+    if(WiFi.status() == WL_CONNECTED) {
+      backfill.service(udp, HOST, String(BF_PORT).toInt());
+    }
+  }
+
   // When ESP32 is interrupted by RTC
   if(cntInt > 0 || (millis() > 259200000UL)) {
     ESP.restart();    // restart ESP when got an interrupt
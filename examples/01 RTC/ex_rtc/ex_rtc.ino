@@ -29,17 +29,21 @@ void setup() {
   // rtc.adjust(DateTime(2019, 12, 31, 23, 59, 0)); // set 31/12/2019 23:59:00
     rtc.adjust(DateTime(F(__DATE__),F(__TIME__)));
   }
+  rtc.hold();                           // collect changes, written in one burst by commit()
   rtc.setAlarm1(23,59,00,0,false,'h');  // h:m:s = 23:59:00 , every 'h'our
   rtc.setAlarm2(00,01,0,false,'m');     // h:m   = 00:01    , every 'm'inute
                                         //                          's'econd (Alarm1 only)
                                         //                          'D'ay
 //  rtc.enableAlarm(1);   // uncomment to enable Alarm 1
 //  rtc.enableAlarm(2);   // uncomment to enable Alarm 2
+  rtc.commit();
 
   Serial.println("- new setting");
   Serial.println("Time   : " + rtc.currentTime());
   Serial.println("Alarm1 : " + rtc.getAlarm1());
   Serial.println("Alarm2 : " + rtc.getAlarm2());
+  Serial.println("Temp   : " + (String)rtc.temperature() + " C");
+  Serial.println("Aging  : " + (String)rtc.agingOffset());
 
   // config interrupt pin of controller
   // Hardware: RTCINT is pin that attach to INT pin of DS3231
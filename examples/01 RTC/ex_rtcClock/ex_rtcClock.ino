@@ -0,0 +1,41 @@
+#include "ESPGW32.h"
+
+CprE_DS3231 rtc(SDA,SCL);
+CprE_rtcClock clk;
+const int rounds = 1000;
+char ts[CLOCK_ISO_LEN];
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("BEGIN");
+  clk.begin(rtc);             // one DS3231 read, aligned to the next second
+  clk.attachSQW(RTCINT);      // optional : re-anchor on every 1 Hz edge (no alarms then)
+
+  // cost of a timestamp : I2C read + String vs software clock
+  unsigned long t = micros();
+  for(int i=0; i<rounds; i++) {
+    String s = rtc.currentTime();
+  }
+  unsigned long t_rtc = micros() - t;
+
+  t = micros();
+  for(int i=0; i<rounds; i++) {
+    clk.iso8601(ts, sizeof(ts), true);
+  }
+  unsigned long t_clk = micros() - t;
+
+  Serial.println("currentTime() : " + (String)(t_rtc/rounds) + " us");
+  Serial.println("iso8601()     : " + (String)(t_clk/rounds) + " us");
+}
+
+void loop() {
+  clk.update();
+  static uint32_t last = 0;
+  if(clk.now() != last) {
+    last = clk.now();
+    clk.iso8601(ts, sizeof(ts), true);
+    Serial.print(ts);
+    Serial.print("  epoch ");
+    Serial.println(last);
+  }
+}
@@ -0,0 +1,33 @@
+// jobs driven by the DS3231 alarm, the ESP32 light-sleeps in between
+// instead of checking millis() in loop()
+
+#include "ESPGW32.h"
+
+CprE_DS3231 rtc(SDA,SCL);
+CprE_scheduler sched;
+
+void pollMeters(void* arg) {
+  Serial.println(rtc.currentTime() + " poll meters");
+}
+
+void upload(void* arg) {
+  Serial.println(rtc.currentTime() + " upload");
+}
+
+void maintenance(void* arg) {
+  Serial.println(rtc.currentTime() + " daily maintenance");
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("BEGIN");
+  sched.begin(rtc, RTCINT);             // takes Alarm1 and the RTCINT interrupt
+  sched.every(60, pollMeters);          // every minute, at hh:mm:00
+  sched.every(300, upload, NULL, 10);   // every 5 minutes, 10 s after the poll
+  sched.every(86400, maintenance, NULL, 3*3600);   // 03:00 RTC time
+  sched.lightSleep(true);
+}
+
+void loop() {
+  sched.run();    // sleeps until the next job is due, then runs it
+}
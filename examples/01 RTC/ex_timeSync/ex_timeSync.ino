@@ -0,0 +1,61 @@
+// Keep the DS3231 on time : SNTP over WiFi every hour, BC95 network time
+// (AT+CCLK?) when WiFi is down. Errors are slewed, the DS3231 aging offset
+// is trimmed once a day of samples shows the drift.
+
+#include "ESPGW32.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#define SSID        ""    // WIFI name
+#define PASS        ""    // WIFI password
+#define NTP_SERVER  "pool.ntp.org"
+#define ZONE        25200 // DS3231 keeps local time, UTC+7
+
+CprE_DS3231 rtc(SDA,SCL);
+CprE_rtcClock clk;
+CprE_timeSync sync;
+CprE_NB_bc95 modem;
+WiFiUDP udp;
+char ts[CLOCK_ISO_LEN];
+unsigned long prev_t = 0;
+unsigned long interval = 3600000;   // interval time of each sample
+
+void doSync() {
+  bool ok = false;
+  if(WiFi.status() == WL_CONNECTED)
+    ok = sync.sampleNTP(udp, NTP_SERVER);
+  if(!ok)
+    ok = sync.sampleModem(modem);
+  clk.iso8601(ts, sizeof(ts), true);
+  Serial.print(ts);
+  Serial.print(ok ? "  error " : "  no reference ");
+  Serial.print(sync.error());
+  Serial.print(" us  drift ");
+  Serial.print(sync.drift());
+  Serial.print(" ppm  aging ");
+  Serial.println(rtc.agingOffset());
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial2.begin(9600,SERIAL_8N1,Uno8,Uno9);
+  modem.init(Serial2);
+  WiFi.begin(SSID, PASS);
+  for(int i=0; i<20 && WiFi.status() != WL_CONNECTED; i++)
+    delay(500);
+  udp.begin(2390);
+  if(WiFi.status() != WL_CONNECTED)
+    modem.register_network();
+
+  clk.begin(rtc);
+  sync.begin(rtc, clk, ZONE);
+  doSync();   // first sample steps the DS3231 in phase
+}
+
+void loop() {
+  clk.update();
+  if(millis() - prev_t > interval) {
+    prev_t = millis();
+    doSync();
+  }
+}
@@ -0,0 +1,58 @@
+// CRC16 benchmark : bitwise loop vs lookup table
+// and a read request whose CRC is computed at compile time
+
+#include "ESPGW32.h"
+
+CprE_modbusRTU m_rtu;
+const int rounds = 1000;
+uint8_t frame[256];
+
+// CRC is calculated by the compiler, nothing is computed at run time
+static constexpr mbFrame readVolt = CprE_crc16::readFrame(1, 0x04, 0, 2);
+
+uint16_t crcBitwise(const uint8_t* data, int len) {
+  uint16_t crc = 0xFFFF;
+  for(int i=0; i<len; i++) {
+    crc ^= data[i];
+    for(uint8_t k=0; k<8; k++) {
+      if(crc & 1) 
+        crc = (crc >> 1) ^ 0xA001;
+      else 
+        crc >>= 1;
+    }
+  }
+  return crc;
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(2400,SERIAL_8N1,RXmax,TXmax);
+  m_rtu.initSerial(Serial1, DIRPIN);
+  for(int i=0; i<sizeof(frame); i++) {
+    frame[i] = i*37 + 5;
+  }
+
+  volatile uint16_t crc;
+  unsigned long t = micros();
+  for(int i=0; i<rounds; i++) {
+    crc = crcBitwise(frame, sizeof(frame));
+  }
+  unsigned long t_bit = micros() - t;
+
+  t = micros();
+  for(int i=0; i<rounds; i++) {
+    crc = CprE_crc16::compute(frame, sizeof(frame));
+  }
+  unsigned long t_table = micros() - t;
+
+  Serial.println("CRC of " + (String)sizeof(frame) + " bytes x " + (String)rounds);
+  Serial.println("bitwise : " + (String)t_bit + " us");
+  Serial.println("table   : " + (String)t_table + " us");
+  Serial.println("same result : " + (String)(crcBitwise(frame, sizeof(frame)) == CprE_crc16::compute(frame, sizeof(frame))));
+
+  m_rtu.sendpacket(readVolt.b, 8);      // frame already has CRC
+  Serial.println("voltage = " + (String)m_rtu.recv_float(1));
+}
+
+void loop() {
+}
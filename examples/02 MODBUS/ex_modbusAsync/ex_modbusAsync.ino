@@ -0,0 +1,44 @@
+// Async Modbus master
+// Requests are queued and handled by poll() in loop(), so loop() never
+// blocks on the RS485 bus and other work (modem, SD card) keeps running.
+
+#include "ESPGW32.h"
+
+CprE_modbusRTU m_rtu;
+const int slave_addr = 1;
+unsigned long prev_t = 0;
+unsigned long interval = 10000;
+
+// called by poll() when response of a request is received (or failed)
+void onFloat(uint8_t SS, uint8_t error, const uint8_t* data, uint8_t len, void* arg) {
+  const char* name = (const char*)arg;
+  CprE_mbView resp(data, len);
+  if(error || !resp.has(0, 2)) {
+    Serial.println((String)name + " : ERROR " + (String)error);
+    return;
+  }
+  Serial.println((String)name + " : " + (String)resp.f32(0));
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(2400,SERIAL_8N1,RXmax,TXmax);
+  m_rtu.initSerial(Serial1, DIRPIN);
+
+  Serial.println("BEGIN");
+  Serial.println();
+}
+
+void loop() {
+  unsigned long curr_t = millis();
+  if(curr_t-prev_t > interval || prev_t == 0) {
+    prev_t = curr_t;
+    m_rtu.enqueueRead(slave_addr, 0x04, 0, 2, onFloat, (void*)"Voltage");
+    m_rtu.enqueueRead(slave_addr, 0x04, 6, 2, onFloat, (void*)"Current");
+    m_rtu.enqueueRead(slave_addr, 0x04, 12, 2, onFloat, (void*)"Active Power");
+  }
+
+  m_rtu.poll();     // move bus state machine forward, never blocks
+
+  // ... other work here (modem, SD card, RTC) ...
+}
@@ -0,0 +1,44 @@
+// Register cache with per-point refresh period
+// Fast values are polled every 10 s, energy totals every 15 minutes.
+// onChange() is called only when a value moved more than its deadband.
+
+#include "ESPGW32.h"
+
+CprE_modbusRTU m_rtu;
+CprE_modbusCache cache;
+const int slave_addr = 1;
+
+// SDM120CT : {point}, period (ms), deadband
+mbCachePoint points[] = {
+  {{slave_addr, 0x04,   0, MB_FLOAT},  10000, 1.0},    // voltage
+  {{slave_addr, 0x04,   6, MB_FLOAT},  10000, 0.1},    // current
+  {{slave_addr, 0x04,  12, MB_FLOAT},  10000, 10.0},   // active power
+  {{slave_addr, 0x04, 342, MB_FLOAT}, 900000, 0.01},   // total active energy
+};
+
+void onChange(int index, const mbCachePoint &p, void* arg) {
+  Serial.println("Register " + (String)p.point.addr + " changed to " + (String)p.point.value);
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(2400,SERIAL_8N1,RXmax,TXmax);
+  m_rtu.initSerial(Serial1, DIRPIN);
+  cache.begin(m_rtu, points, sizeof(points)/sizeof(points[0]));
+  cache.onChange(onChange);
+
+  Serial.println("BEGIN");
+  Serial.println();
+}
+
+void loop() {
+  cache.update();     // only due points go on the bus
+
+  static unsigned long prev_t = 0;
+  if(millis()-prev_t > 60000) {
+    prev_t = millis();
+    float kWh;
+    if(cache.get(slave_addr, 0x04, 342, kWh))     // served from memory
+      Serial.println("Total Active Energy : " + (String)kWh + " kWh");
+  }
+}
@@ -0,0 +1,51 @@
+// Poll two RS485 segments in parallel
+// Each bus gets its own FreeRTOS task (pinned to a core) and result queue.
+// loop() only takes finished results out of the queues.
+
+#include "ESPGW32.h"
+
+#define DIRPIN2   4     // direction pin of 2nd RS485 transceiver (on Uno shield)
+
+CprE_busManager buses;
+
+// segment A : SDM120CT meters on MAX485
+mbPoint segA[] = {
+  {1, 0x04,   0, MB_FLOAT},   // meter 1 voltage
+  {1, 0x04,   6, MB_FLOAT},   // meter 1 current
+  {1, 0x04, 342, MB_FLOAT},   // meter 1 total active energy
+  {2, 0x04,   0, MB_FLOAT},   // meter 2 voltage
+  {2, 0x04,   6, MB_FLOAT},   // meter 2 current
+  {2, 0x04, 342, MB_FLOAT},   // meter 2 total active energy
+};
+
+// segment B : wind sensors on Uno shield
+mbPoint segB[] = {
+  {3, 0x03, 0, MB_UINT16},    // YGC-FS wind speed (x10)
+  {4, 0x03, 0, MB_UINT16},    // YGC-FX wind direction
+};
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(2400,SERIAL_8N1,RXmax,TXmax);
+  Serial2.begin(9600,SERIAL_8N1,Uno8,Uno9);
+
+  buses.addBus(Serial1, DIRPIN, segA, sizeof(segA)/sizeof(segA[0]), 10000, 0);
+  buses.addBus(Serial2, DIRPIN2, segB, sizeof(segB)/sizeof(segB[0]), 5000, 1);
+  if(!buses.start()) 
+    Serial.println("Cannot start bus tasks!");
+
+  Serial.println("BEGIN");
+  Serial.println();
+}
+
+void loop() {
+  mbResult res;
+  while(buses.getResult(res)) {
+    Serial.print("bus " + (String)res.bus + " point " + (String)res.index + " : ");
+    if(res.error) 
+      Serial.println("ERROR " + (String)res.error);
+    else 
+      Serial.println(res.value);
+  }
+  delay(10);
+}
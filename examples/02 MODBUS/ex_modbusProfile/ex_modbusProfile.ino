@@ -0,0 +1,61 @@
+// Device profiles : register maps are tables in flash, a site is a list
+// of meters and one poll() reads them all with merged requests.
+// A meter more is a row in <site>, a new model is a profile table.
+
+#include "ESPGW32.h"
+
+CprE_modbusRTU m_rtu;
+CprE_mbPoller poller;
+unsigned long prev_t = 0;
+unsigned long interval = 10000;
+
+// own profile : sorted by function code then address
+constexpr mbProfilePoint myMeterPoints[] = {
+  {"voltage",  0x03, 0, MB_UINT16, MB_ABCD, 0.1f, "V"},
+  {"current",  0x03, 1, MB_UINT16, MB_ABCD, 0.01f, "A"},
+  {"energy",   0x03, 8, MB_UINT32, MB_CDAB, 1, "Wh"}
+};
+static_assert(mbProfileSorted(myMeterPoints), "profile not sorted");
+const mbProfile myMeter = MB_PROFILE("myMeter", myMeterPoints);
+
+double sdm1[14], sdm2[14], own[3];
+mbDevice site[] = {
+  {1, &mbSDM120CT, sdm1},
+  {2, &mbSDM120CT, sdm2},
+  {10, &myMeter, own}
+};
+const int n_site = sizeof(site)/sizeof(site[0]);
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(2400,SERIAL_8N1,RXmax,TXmax);
+  m_rtu.initSerial(Serial1, DIRPIN);
+  poller.begin(m_rtu, site, n_site);
+
+  Serial.println("BEGIN");
+  Serial.println();
+}
+
+void loop() {
+  unsigned long curr_t = millis();
+  if(curr_t-prev_t > interval || prev_t == 0) {
+    prev_t = curr_t;
+
+    int requests = poller.poll();
+    Serial.println("Requests sent : " + (String)requests + ", failed meters : " + (String)poller.failed());
+    for(int i=0; i<n_site; i++) {
+      const mbProfile &p = *site[i].profile;
+      Serial.print((String)p.model + " @" + (String)site[i].slave);
+      if(site[i].error) 
+        Serial.print(" ERROR " + (String)site[i].error);
+      Serial.println();
+      for(int k=0; k<p.count; k++) {
+        Serial.println("  " + (String)p.points[k].name + " = " + (String)site[i].values[k] + " " + p.points[k].unit);
+      }
+      // CSV part of a packet
+      CprE_mbPoller::print(Serial, site[i]);
+      Serial.println();
+    }
+    Serial.println();
+  }
+}
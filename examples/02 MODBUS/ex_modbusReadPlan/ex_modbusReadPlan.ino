@@ -0,0 +1,51 @@
+// Read many registers with a few requests
+// Points of the same slave and function code which are close together
+// are merged into one FC03/FC04 request (up to 125 registers)
+
+#include "ESPGW32.h"
+
+CprE_modbusRTU m_rtu;
+const int slave_addr = 1;
+unsigned long prev_t = 0;
+unsigned long interval = 10000;
+
+// SDM120CT-MV input registers (float)
+mbPoint points[] = {
+  {slave_addr, 0x04,   0, MB_FLOAT},    // voltage
+  {slave_addr, 0x04,   6, MB_FLOAT},    // current
+  {slave_addr, 0x04,  12, MB_FLOAT},    // active power
+  {slave_addr, 0x04,  18, MB_FLOAT},    // apparent power
+  {slave_addr, 0x04,  24, MB_FLOAT},    // reactive power
+  {slave_addr, 0x04,  30, MB_FLOAT},    // power factor
+  {slave_addr, 0x04,  70, MB_FLOAT},    // frequency
+  {slave_addr, 0x04,  72, MB_FLOAT},    // import active energy
+  {slave_addr, 0x04, 342, MB_FLOAT},    // total active energy
+};
+const int n_points = sizeof(points)/sizeof(points[0]);
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(2400,SERIAL_8N1,RXmax,TXmax);
+  m_rtu.initSerial(Serial1, DIRPIN);
+
+  Serial.println("BEGIN");
+  Serial.println();
+}
+
+void loop() {
+  unsigned long curr_t = millis();
+  if(curr_t-prev_t > interval || prev_t == 0) {
+    prev_t = curr_t;
+
+    int requests = m_rtu.readPlan(points, n_points);
+    Serial.println("Requests sent : " + (String)requests);
+    for(int i=0; i<n_points; i++) {
+      Serial.print("Register " + (String)points[i].addr + " : ");
+      if(points[i].error) 
+        Serial.println("ERROR " + (String)points[i].error);
+      else 
+        Serial.println(points[i].value);
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,38 @@
+// ESPGW32 as Modbus RTU slave
+// A SCADA master on the RS485 line can read the gateway's data:
+//   input registers 0..3   : uptime (s), RSSI, temperature x10, packet counter
+//   holding registers 0..1 : report interval (s), setpoint (written by master)
+//   coils 0..7             : output flags
+
+#include "ESPGW32.h"
+
+#define SLAVE_ID    10
+
+CprE_modbusSlave slave;
+uint16_t inputRegs[4];
+uint16_t holdingRegs[2] = {300, 0};
+uint8_t coils[1];
+
+void onWrite(uint8_t func, uint16_t addr, uint16_t count, void* arg) {
+  Serial.println("Master wrote FC" + (String)func + " at " + (String)addr + " x" + (String)count);
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(9600,SERIAL_8N1,RXmax,TXmax);
+  slave.begin(Serial1, DIRPIN, SLAVE_ID);
+  slave.setInput(inputRegs, 0, 4);
+  slave.setHolding(holdingRegs, 0, 2);
+  slave.setCoils(coils, 0, 8);
+  slave.onWrite(onWrite);
+
+  Serial.println("BEGIN");
+  Serial.println();
+}
+
+void loop() {
+  slave.task();       // answer requests, never blocks while line is idle
+
+  inputRegs[0] = millis()/1000;
+  inputRegs[3]++;
+}
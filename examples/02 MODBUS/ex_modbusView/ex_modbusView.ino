@@ -0,0 +1,47 @@
+// Decode several values from one response
+// response() gives a typed view over the receive buffer, no copy is made.
+
+#include "ESPGW32.h"
+
+CprE_modbusRTU m_rtu;
+const int slave_addr = 1;
+unsigned long prev_t = 0;
+unsigned long interval = 10000;
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(2400,SERIAL_8N1,RXmax,TXmax);
+  m_rtu.initSerial(Serial1, DIRPIN);
+
+  Serial.println("BEGIN");
+  Serial.println();
+}
+
+void loop() {
+  unsigned long curr_t = millis();
+  if(curr_t-prev_t > interval || prev_t == 0) {
+    prev_t = curr_t;
+
+    // SDM120CT : register 0..13 = voltage, -, -, current, -, -, active power (float, ABCD)
+    m_rtu.sendReadInput(slave_addr,0,14);
+    m_rtu.recv(slave_addr);
+    if(m_rtu.getError()) {
+      Serial.println("ERROR! " + m_rtu.errorReport());
+      return;
+    }
+    CprE_mbView resp = m_rtu.response();
+    Serial.println("Voltage      : " + (String)resp.f32(0) + " Volts");
+    Serial.println("Current      : " + (String)resp.f32(6) + " Amps");
+    Serial.println("Active Power : " + (String)resp.f32(12) + " Watts");
+
+    // same data read as S7-1200 word order would be resp.f32(0, MB_CDAB)
+
+    // decode the whole block in one pass, order is fixed at compile time
+    float vals[7];
+    int n = resp.getBlock<MB_ABCD, float>(0, vals, 7);
+    for(int i=0; i<n; i++) {
+      Serial.println("Register " + (String)(2*i) + " : " + (String)vals[i]);
+    }
+    Serial.println();
+  }
+}
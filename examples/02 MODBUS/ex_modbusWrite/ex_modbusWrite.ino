@@ -0,0 +1,47 @@
+// Write registers and coils
+// Single writes use FC05/FC06, CprE_mbWriteBatch coalesces adjacent
+// registers of the same slave into one FC16 frame.
+
+#include "ESPGW32.h"
+
+CprE_modbusRTU m_rtu;
+CprE_mbWriteBatch batch;
+const int slave_addr = 1;   // Slave Address of Modbus Device
+
+void setup() {
+  Serial.begin(9600);
+  Serial1.begin(9600,SERIAL_8N1,RXmax,TXmax);
+  m_rtu.initSerial(Serial1, DIRPIN);
+
+  Serial.println("BEGIN");
+  Serial.println();
+
+  // single coil and register
+  m_rtu.sendWriteCoil(slave_addr, 0, true);
+  Serial.println("Coil 0 ON       : " + (String)(m_rtu.recv_write(slave_addr)? "OK" : m_rtu.errorReport()));
+  m_rtu.sendWriteRegister(slave_addr, 10, 1234);
+  Serial.println("Register 10     : " + (String)(m_rtu.recv_write(slave_addr)? "OK" : m_rtu.errorReport()));
+
+  // setpoints 20..25 go out as one FC16 frame
+  batch.add(slave_addr, 20, 100);
+  batch.add(slave_addr, 21, 200);
+  batch.add(slave_addr, 22, 300);
+  batch.add<MB_CDAB, float>(slave_addr, 23, 42.5);   // registers 23,24
+  batch.add(slave_addr, 25, 1);
+  int frames = batch.flush(m_rtu);
+  Serial.println("Batch frames    : " + (String)frames + ", failed " + (String)batch.failed());
+
+  // write 2 registers and read 4 registers back in one transaction
+  uint16_t values[2] = {7, 8};
+  m_rtu.sendReadWriteRegisters(slave_addr, 20, 4, 30, values, 2);
+  m_rtu.recv(slave_addr);
+  if(!m_rtu.getError()) {
+    CprE_mbView resp = m_rtu.response();
+    for(int i=0; i<resp.regs(); i++) {
+      Serial.println("Register " + (String)(20+i) + "     : " + (String)resp.u16(i));
+    }
+  }
+}
+
+void loop() {
+}
@@ -0,0 +1,71 @@
+// backfill from the SD log : every reading is stored with CprE_logStore,
+// live readings are sent at once and whatever the server missed while the
+// network was down is sent again in packed batches once it is back
+
+#include "ESPGW32.h"
+#include "FS.h"
+#include "SD.h"
+#include "SPI.h"
+
+#define HOST ""     // server ip
+#define PORT ""     // server udp port
+
+// define pins
+int sck = 21;
+int miso = 19;
+int mosi = 18;
+int cs = 14;
+
+CprE_DS3231 rtc(SDA,SCL);
+CprE_NB_bc95 modem;
+CprE_logStore store;
+CprE_backfill backfill;
+char sock[] = "0\0";
+unsigned long prev_t = 0;
+unsigned long interval = 10000;
+unsigned long cntUpNumber = 1;    // data example
+
+void setup() {
+  Serial.begin(9600);
+  SPI.begin(sck, miso, mosi, cs);
+  if(!SD.begin(cs)) {
+    Serial.println("Card Mount Failed");
+    return;
+  }
+  store.begin(SD, "/logs", rtc);
+  backfill.begin(SD, store, "/logs/cursor");
+  backfill.setRate(2000, 1);        // one datagram every 2 s, the rest is for live data
+  Serial.println("cursor : " + (String)backfill.segment() + " @" + (String)backfill.offset());
+
+  Serial2.begin(9600,SERIAL_8N1,Uno8,Uno9);
+  modem.init(Serial2);
+  modem.initModem();
+  modem.register_network();         // no restart on failure, the SD keeps data
+  modem.create_UDP_socket(4700,sock);
+}
+
+void loop() {
+  unsigned long curr_t = millis();
+  if(curr_t-prev_t > interval || prev_t == 0) {
+    prev_t = curr_t;
+    char line[48];
+    snprintf(line, sizeof(line), "%s,%lu", rtc.currentTime().c_str(), cntUpNumber++);
+    bool caughtUp = !backfill.pending();
+    store.append(line);
+    // live send, same [len][record] packing as the backfill
+    uint8_t dgram[50];
+    uint16_t len = strlen(line);
+    dgram[0] = len;
+    dgram[1] = len >> 8;
+    memcpy(dgram + 2, line, len);
+    if(modem.sendUDP(HOST, PORT, dgram, len + 2) && caughtUp) {
+      backfill.skip();
+    }
+  }
+  store.service();
+  int sent = backfill.service(modem, HOST, PORT);
+  if(sent > 0) {
+    Serial.println("backfill : " + (String)sent + " datagram(s), " + (String)backfill.records() + " records");
+  }
+  modem.process();
+}
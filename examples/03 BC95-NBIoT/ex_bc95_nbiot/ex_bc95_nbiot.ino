@@ -9,12 +9,19 @@ unsigned long prev_t = 0;
 unsigned long interval = 5000;
 unsigned long cntUpNumber = 1;    // data example
 
+// called by the library when the modem reports a received datagram
+void onReceive(const char* line, void* arg) {
+  Serial.print("URC : ");
+  Serial.println(line);             // +NSONMI:<socket>,<length>
+}
+
 void setup() {
   Serial.begin(9600);
   
   // configure serial to connect with NBIoT Shield
   Serial2.begin(9600,SERIAL_8N1,Uno8,Uno9);
   modem.init(Serial2);
+  modem.onURC("+NSONMI:", onReceive);
   modem.initModem();
   
   Serial.println("BEGIN");
@@ -35,6 +42,7 @@ void setup() {
 }
 
 void loop() {
+  modem.process();                  // handle unsolicited modem messages
   unsigned long curr_t = millis();
   if(curr_t-prev_t > interval || prev_t == 0) {
     prev_t = curr_t;
@@ -0,0 +1,103 @@
+// AT+NSOST encoding benchmark : per byte itoa/print vs sendUDP()
+// no modem needed, a mock stream counts the calls and answers like a BC95
+
+#include "ESPGW32.h"
+
+const int rounds = 200;
+uint8_t payload[100];
+
+// counts write calls/bytes and replies "0,<len>" + OK to every command
+class MockModem : public Stream {
+  public:
+    unsigned long calls = 0, bytes = 0;
+    char reply[24];
+    int replyLen = 0, replyPos = 0;
+    int lastComma = 0, hexLen = 0;
+
+    size_t write(uint8_t c) {
+      calls++;
+      take(c);
+      return 1;
+    }
+    size_t write(const uint8_t* buf, size_t size) {
+      calls++;
+      for(size_t i=0; i<size; i++) 
+        take(buf[i]);
+      return size;
+    }
+    int available() { return replyLen - replyPos; }
+    int read() { return available()? reply[replyPos++] : -1; }
+    int peek() { return available()? reply[replyPos] : -1; }
+    void flush() {}
+
+  private:
+    void take(uint8_t c) {
+      bytes++;
+      if(c == ',') {
+        hexLen = 0;
+      }
+      else if(c == '\n') {
+        replyLen = snprintf(reply, sizeof(reply), "\r\n0,%d\r\n\r\nOK\r\n", hexLen/2);
+        replyPos = 0;
+      }
+      else if(c != '\r') {
+        hexLen++;
+      }
+    }
+};
+
+MockModem mock;
+CprE_NB_bc95 modem;
+
+// the way sendUDPstr used to do it
+void legacySend(Stream& s, String ip, String port, String data) {
+  s.print(F("AT+NSOST=0"));
+  s.print(F(","));
+  s.print(ip);
+  s.print(F(","));
+  s.print(port);
+  s.print(F(","));
+  s.print(String(data.length()));
+  s.print(F(","));
+  char fetch[3];
+  for(int i=0; i<data.length(); i++) {
+    itoa((int)data[i], fetch, 16);
+    s.print(fetch);
+  }
+  s.print("\r\n");
+}
+
+void setup() {
+  Serial.begin(9600);
+  modem.init(mock);
+  for(int i=0; i<sizeof(payload); i++) {
+    payload[i] = 'A' + i%26;         // printable, legacy path cannot send binary
+  }
+  String data = "";
+  for(int i=0; i<sizeof(payload); i++) {
+    data += (char)payload[i];
+  }
+
+  unsigned long t = micros();
+  for(int i=0; i<rounds; i++) {
+    legacySend(mock, "1.2.3.4", "5683", data);
+  }
+  unsigned long t_legacy = micros() - t;
+  unsigned long calls_legacy = mock.calls;
+
+  mock.calls = 0;
+  int ok = 0;
+  t = micros();
+  for(int i=0; i<rounds; i++) {
+    ok += modem.sendUDP("1.2.3.4", "5683", payload, sizeof(payload));
+  }
+  unsigned long t_new = micros() - t;
+
+  Serial.println("AT+NSOST of " + (String)sizeof(payload) + " bytes x " + (String)rounds);
+  Serial.println("itoa/print : " + (String)t_legacy + " us, " + (String)(calls_legacy/rounds) + " writes/packet");
+  Serial.println("sendUDP    : " + (String)t_new + " us, " + (String)(mock.calls/rounds) + " writes/packet (incl. reply wait)");
+  Serial.println("confirmed  : " + (String)ok + "/" + (String)rounds);
+}
+
+void loop() {
+}
@@ -0,0 +1,42 @@
+// confirmable CoAP POST over NB-IoT, resent until the server acknowledges
+
+#include "ESPGW32.h"
+
+#define HOST ""     // CoAP server ip
+
+CprE_NB_bc95 modem;
+CprE_coap coap;
+char sock[] = "0\0";
+unsigned long prev_t = 0;
+unsigned long interval = 60000;
+unsigned long cntUpNumber = 1;    // data example
+
+void setup() {
+  Serial.begin(9600);
+  Serial2.begin(9600,SERIAL_8N1,Uno8,Uno9);
+  modem.init(Serial2);
+  modem.initModem();
+  modem.register_network();
+  modem.create_UDP_socket(5683,sock);
+  coap.begin(modem, HOST);          // default port 5683
+  coap.setRetry(2000, 4);           // resend after 2, 4, 8, 16 s
+}
+
+void loop() {
+  unsigned long curr_t = millis();
+  if(curr_t-prev_t > interval || prev_t == 0) {
+    prev_t = curr_t;
+    String data = "{\"device\":\"device1\",\"count\":" + (String)cntUpNumber++ + "}";
+    // content format 50 = application/json
+    uint8_t code = coap.post("telemetry", (const uint8_t*)data.c_str(), data.length(), 50);
+    if(code == 0) {
+      Serial.println("no answer from server");
+    }
+    else {
+      // response code class.detail, e.g. 2.01 Created
+      Serial.print("response " + (String)(code >> 5) + "." + (code & 0x1F) + " after ");
+      Serial.println((String)coap.retransmissions() + " retransmission(s)");
+    }
+  }
+  modem.process();
+}
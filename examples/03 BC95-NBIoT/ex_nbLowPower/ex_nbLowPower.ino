@@ -0,0 +1,42 @@
+// battery site : one uplink every 15 minutes, ESP32 in deep sleep and the
+// modem in PSM in between. DS3231 Alarm1 wakes the ESP32 through RTCINT,
+// the modem stays attached so no AT+NRB / re-attach on each wake-up
+
+#include "ESPGW32.h"
+
+#define HOST ""     // server ip
+#define PORT ""     // server udp port
+#define PERIOD 900  // seconds between uplinks
+
+CprE_DS3231 rtc(SDA,SCL);
+CprE_NB_bc95 modem;
+CprE_nbSession session;
+char sock[] = "0\0";
+RTC_DATA_ATTR unsigned long cntUpNumber = 1;    // kept in RTC memory over deep sleep
+
+void setup() {
+  Serial.begin(9600);
+  Serial2.begin(9600,SERIAL_8N1,Uno8,Uno9);
+  modem.init(Serial2);
+
+  unsigned long t = millis();
+  if(session.begin(modem)) {
+    if(cntUpNumber == 1) {
+      session.plan(PERIOD);             // only once, modem keeps the setting
+    }
+    modem.create_UDP_socket(4700,sock);
+    String data = "\"NBIoT-node\",\"device1\"," + (String)cntUpNumber++;
+    // last uplink of this wake-up, network may release the radio right away
+    bool ok = session.send(HOST, PORT, (const uint8_t*)data.c_str(), data.length(), true);
+    Serial.println((String)(ok? "sent" : "send failed") + " in " + (String)(millis()-t) + " ms, attaches " + (String)session.attaches());
+  }
+
+  uint32_t wake = session.scheduleWake(rtc, PERIOD);
+  Serial.println("next wake-up at " + DateTime(wake).timestamp());
+  Serial.flush();
+  esp_sleep_enable_ext0_wakeup((gpio_num_t)RTCINT, 0);   // DS3231 INT is active low
+  esp_deep_sleep_start();
+}
+
+void loop() {
+}
@@ -0,0 +1,73 @@
+// packet size and encode time : CSV String (as Project5) vs binary telemetry
+// both go through sendUDP as hex, so bytes on air are twice the packet size
+
+#include "ESPGW32.h"
+
+const int rounds = 1000;
+const int batch = 10;               // records per datagram in batched mode
+
+// SDM120CT values of Project5, same order as the CSV packet
+static const tmField sdmFields[] = {
+  {"volt", 10}, {"current", 100}, {"actPower", 10}, {"appPower", 10},
+  {"reactPower", 10}, {"pfactor", 1000}, {"phase", 10}, {"freq", 100},
+  {"imAct", 100}, {"exAct", 100}, {"imReact", 100}, {"exReact", 100},
+  {"totalAct", 100}, {"totalReact", 100}, {"packet_no", 1}
+};
+static const tmSchema sdmSchema = {1, 15, sdmFields};
+
+float values[15] = {230.4, 4.21, 950.2, 970.1, 195.3, 0.979, 11.5, 50.01,
+                    1520.33, 0.00, 310.72, 2.15, 1520.33, 312.87, 1};
+uint8_t packet[256];
+
+String csvPacket() {
+  String p = "\"SDM120CT-MV\",\"device1\",";
+  for(int i=0; i<14; i++) {
+    p += (String)values[i];
+    p += ",";
+  }
+  p += (String)(int)values[14];
+  return p;
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  unsigned long t = micros();
+  String csv;
+  for(int i=0; i<rounds; i++) {
+    csv = csvPacket();
+  }
+  unsigned long t_csv = micros() - t;
+
+  size_t len = 0;
+  t = micros();
+  for(int i=0; i<rounds; i++) {
+    CprE_tmEncoder enc(sdmSchema, packet, sizeof(packet));
+    enc.add(values);
+    len = enc.length();
+  }
+  unsigned long t_bin = micros() - t;
+
+  // batched : following records only carry the change
+  CprE_tmEncoder enc(sdmSchema, packet, sizeof(packet));
+  for(int i=0; i<batch; i++) {
+    values[0] += 0.1;
+    values[12] += 0.02;
+    values[14] += 1;
+    enc.add(values);
+  }
+
+  Serial.println("CSV    : " + (String)csv.length() + " bytes, " + (String)(2*csv.length()) + " on air, " + (String)(t_csv/rounds) + " us");
+  Serial.println("binary : " + (String)len + " bytes, " + (String)(2*len) + " on air, " + (String)(t_bin/rounds) + " us");
+  Serial.println("binary x" + (String)enc.records() + " : " + (String)enc.length() + " bytes");
+
+  // what the ingest side does with it
+  CprE_tmDecoder dec(packet, enc.length());
+  double v[15];
+  while(dec.next(sdmSchema, v)) {
+    Serial.println("volt " + (String)v[0] + " totalAct " + (String)v[12] + " packet_no " + (String)v[14]);
+  }
+}
+
+void loop() {
+}
@@ -0,0 +1,53 @@
+// store-and-forward uplink : readings go to a queue file on SPIFFS and are
+// sent in batches whenever the modem is attached, nothing is lost while
+// the network is down or the board restarts
+
+#include "ESPGW32.h"
+#include "SPIFFS.h"
+
+#define HOST ""     // server ip
+#define PORT ""     // server udp port
+
+CprE_NB_bc95 modem;
+CprE_uplinkQueue queue;
+char sock[] = "0\0";
+unsigned long prev_t = 0;
+unsigned long interval = 10000;
+unsigned long cntUpNumber = 1;    // data example
+
+static const tmField fields[] = {{"uptime", 1}, {"counter", 1}};
+static const tmSchema schema = {1, 2, fields};
+
+void setup() {
+  Serial.begin(9600);
+  SPIFFS.begin(true);
+  queue.begin(SPIFFS, "/uplink.bin", 32768);
+  queue.setRate(2000, 4);           // max 4 datagrams every 2 s while draining
+  Serial.println("queued from last run : " + (String)queue.count());
+
+  Serial2.begin(9600,SERIAL_8N1,Uno8,Uno9);
+  modem.init(Serial2);
+  modem.initModem();
+  modem.register_network();         // no restart on failure, queue keeps data
+  modem.create_UDP_socket(4700,sock);
+}
+
+void loop() {
+  unsigned long curr_t = millis();
+  if(curr_t-prev_t > interval || prev_t == 0) {
+    prev_t = curr_t;
+    uint8_t rec[32];
+    CprE_tmEncoder enc(schema, rec, sizeof(rec));
+    enc.begin();
+    enc.putInt(curr_t/1000);
+    enc.putInt(cntUpNumber++);
+    enc.end();
+    queue.push(rec, enc.length());
+    Serial.println("queued : " + (String)queue.count() + " records, " + (String)queue.bytes() + " bytes");
+  }
+  int sent = queue.service(modem, HOST, PORT);
+  if(sent > 0) {
+    Serial.println("sent " + (String)sent + " datagram(s), left " + (String)queue.count());
+  }
+  modem.process();
+}
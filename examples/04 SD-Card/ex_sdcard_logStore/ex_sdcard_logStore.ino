@@ -0,0 +1,50 @@
+// Segmented, crash safe logging on the SD card
+// One segment per day in /logs, every record has a CRC16. After a power
+// cut the torn tail is left behind and logging goes on in a new segment.
+// Oldest segments are deleted when less than 50 MB are free.
+#include "ESPGW32.h"
+#include "FS.h"
+#include "SD.h"
+#include "SPI.h"
+
+// define pins
+int sck = 21;
+int miso = 19;
+int mosi = 18;
+int cs = 14;
+
+CprE_DS3231 rtc(SDA,SCL);
+CprE_logStore store;
+unsigned long prev_t = 0;
+unsigned long interval = 5000;
+
+uint64_t sdFree() {
+  return SD.totalBytes() - SD.usedBytes();
+}
+
+void setup() {
+  Serial.begin(9600);
+  SPI.begin(sck, miso, mosi, cs);
+  if(!SD.begin(cs)) {
+    Serial.println("Card Mount Failed");
+    return;
+  }
+  store.begin(SD, "/logs", rtc);
+  store.setRetention(50ULL * 1024 * 1024, sdFree);
+  Serial.print("Logging to ");
+  Serial.println(store.segment());
+  if(store.recovered() > 0) {
+    Serial.println("Torn tail left behind : " + (String)store.recovered() + " bytes");
+  }
+}
+
+void loop() {
+  static unsigned long count = 1;
+  store.service();
+  if(millis() - prev_t > interval) {
+    prev_t = millis();
+    char line[64];
+    snprintf(line, sizeof(line), "\"counter\",\"device1\",%lu,%ld", count++, random(10, 50));
+    store.append(line);
+  }
+}
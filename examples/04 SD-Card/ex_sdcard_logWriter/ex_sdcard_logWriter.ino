@@ -0,0 +1,75 @@
+// Buffered log writer against open/append/close per line
+// Both write the same rows, time and file writes are printed.
+#include "ESPGW32.h"
+#include "FS.h"
+#include "SD.h"
+#include "SPI.h"
+
+// define pins
+int sck = 21;
+int miso = 19;
+int mosi = 18;
+int cs = 14;
+const int rows = 500;
+
+CprE_logWriter logger;
+unsigned long prev_t = 0;
+unsigned long interval = 5000;
+
+void appendFile(fs::FS &fs, const char * path, const char * message){
+  File file = fs.open(path, FILE_APPEND);
+  if(!file){
+    Serial.println("Failed to open file for appending");
+    return;
+  }
+  file.print(message);
+  file.close();
+}
+
+void setup() {
+  Serial.begin(9600);
+  SPI.begin(sck, miso, mosi, cs);
+  if(!SD.begin(cs)) {
+    Serial.println("Card Mount Failed");
+    return;
+  }
+  SD.remove("/bench_append.txt");
+  SD.remove("/bench_writer.txt");
+
+  char line[64];
+  unsigned long t = millis();
+  for(int i=0; i<rows; i++) {
+    snprintf(line, sizeof(line), "\"counter\",\"device1\",%d,%ld\r\n", i, random(10, 50));
+    appendFile(SD, "/bench_append.txt", line);
+  }
+  unsigned long t_append = millis() - t;
+
+  t = millis();
+  logger.begin(SD, "/bench_writer.txt");
+  for(int i=0; i<rows; i++) {
+    snprintf(line, sizeof(line), "\"counter\",\"device1\",%d,%ld\r\n", i, random(10, 50));
+    logger.print(line);
+  }
+  logger.sync();
+  unsigned long t_writer = millis() - t;
+
+  Serial.println("appendFile : " + (String)t_append + " ms, " + (String)rows + " open/write/close");
+  Serial.println("logWriter  : " + (String)t_writer + " ms, " + (String)logger.writes() + " writes");
+  logger.end();
+
+  // normal logging : records are on the card at most 10 s after print()
+  logger.begin(SD, "/datalog.txt", 10000);
+}
+
+void loop() {
+  static unsigned long count = 1;
+  logger.service();
+  if(millis() - prev_t > interval) {
+    prev_t = millis();
+    logger.print("\"counter\",\"device1\",");
+    logger.print(count++);
+    logger.print(",");
+    logger.print(random(10, 50));
+    logger.print("\r\n");
+  }
+}
@@ -0,0 +1,60 @@
+// Binary time series on the SD card
+// A row of meter values every 5 s into /meter.tsf, blocks of 24 rows are
+// written column wise. Send 'e' on Serial to export the last hour as CSV.
+#include "ESPGW32.h"
+#include "FS.h"
+#include "SD.h"
+#include "SPI.h"
+
+// define pins
+int sck = 21;
+int miso = 19;
+int mosi = 18;
+int cs = 14;
+
+const tmField meterFields[] = {
+  {"volt", 10}, {"amp", 100}, {"power", 10}, {"energy", 100}
+};
+const tmSchema meter = {1, 4, meterFields};
+
+CprE_DS3231 rtc(SDA,SCL);
+CprE_rtcClock clk;
+CprE_tsWriter series;
+uint8_t block[512];           // 1 sector : 24 rows of 4 fields
+uint8_t readBlock[512];
+unsigned long prev_t = 0;
+unsigned long interval = 5000;
+
+void setup() {
+  Serial.begin(9600);
+  SPI.begin(sck, miso, mosi, cs);
+  if(!SD.begin(cs)) {
+    Serial.println("Card Mount Failed");
+    return;
+  }
+  clk.begin(rtc);
+  if(!series.begin(SD, "/meter.tsf", meter, block, sizeof(block))) {
+    Serial.println("Failed to open /meter.tsf");
+  }
+}
+
+void loop() {
+  clk.update();
+  if(millis() - prev_t > interval) {
+    prev_t = millis();
+    float v[4] = {229.5 + random(-20, 20) / 10.0, random(0, 500) / 100.0, 0, 0};
+    v[2] = v[0] * v[1];
+    v[3] = millis() / 3600000.0;
+    series.append(clk.now(), v);
+    series.sync();
+  }
+
+  if(Serial.read() == 'e') {
+    CprE_tsReader reader;
+    if(reader.open(SD, "/meter.tsf", readBlock, sizeof(readBlock))) {
+      uint32_t rows = reader.exportCSV(Serial, clk.now() - 3600, clk.now());
+      Serial.println((String)rows + " rows, " + (String)reader.blocks() + " blocks");
+      reader.close();
+    }
+  }
+}